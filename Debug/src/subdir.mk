@@ -4,38 +4,104 @@
 
 # Add inputs and outputs from these tool invocations to the build variables 
 CPP_SRCS += \
+../src/adaptive.cpp \
+../src/animation.cpp \
+../src/arena.cpp \
 ../src/bitmap.cpp \
+../src/budget.cpp \
+../src/bvh.cpp \
 ../src/camera.cpp \
+../src/checkpoint.cpp \
+../src/context.cpp \
+../src/denoise.cpp \
+../src/distributed.cpp \
 ../src/geometry.cpp \
+../src/interactive.cpp \
 ../src/main.cpp \
 ../src/matrix.cpp \
+../src/net.cpp \
+../src/output.cpp \
+../src/pathtracer.cpp \
+../src/raydebug.cpp \
+../src/regress.cpp \
+../src/reproject.cpp \
+../src/sampler.cpp \
 ../src/sdl.cpp \
-../src/shading.cpp 
+../src/server.cpp \
+../src/shading.cpp \
+../src/shadowmap.cpp \
+../src/stats.cpp \
+../src/threads.cpp \
+../src/wavefront.cpp 
 
 OBJS += \
+./src/adaptive.o \
+./src/animation.o \
+./src/arena.o \
 ./src/bitmap.o \
+./src/budget.o \
+./src/bvh.o \
 ./src/camera.o \
+./src/checkpoint.o \
+./src/context.o \
+./src/denoise.o \
+./src/distributed.o \
 ./src/geometry.o \
+./src/interactive.o \
 ./src/main.o \
 ./src/matrix.o \
+./src/net.o \
+./src/output.o \
+./src/pathtracer.o \
+./src/raydebug.o \
+./src/regress.o \
+./src/reproject.o \
+./src/sampler.o \
 ./src/sdl.o \
-./src/shading.o 
+./src/server.o \
+./src/shading.o \
+./src/shadowmap.o \
+./src/stats.o \
+./src/threads.o \
+./src/wavefront.o 
 
 CPP_DEPS += \
+./src/adaptive.d \
+./src/animation.d \
+./src/arena.d \
 ./src/bitmap.d \
+./src/budget.d \
+./src/bvh.d \
 ./src/camera.d \
+./src/checkpoint.d \
+./src/context.d \
+./src/denoise.d \
+./src/distributed.d \
 ./src/geometry.d \
+./src/interactive.d \
 ./src/main.d \
 ./src/matrix.d \
+./src/net.d \
+./src/output.d \
+./src/pathtracer.d \
+./src/raydebug.d \
+./src/regress.d \
+./src/reproject.d \
+./src/sampler.d \
 ./src/sdl.d \
-./src/shading.d 
+./src/server.d \
+./src/shading.d \
+./src/shadowmap.d \
+./src/stats.d \
+./src/threads.d \
+./src/wavefront.d 
 
 
 # Each subdirectory must supply rules for building sources it contributes
 src/%.o: ../src/%.cpp
 	@echo 'Building file: $<'
 	@echo 'Invoking: GCC C++ Compiler'
-	g++ -O0 -g3 -Wall -c -fmessage-length=0 -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@:%.o=%.d)" -o"$@" "$<"
+	g++ -DRAY_DEBUG -O0 -g3 -Wall -c -fmessage-length=0 -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@:%.o=%.d)" -o"$@" "$<"
 	@echo 'Finished building: $<'
 	@echo ' '
 
@@ -121,6 +121,94 @@ SOURCE=.\src\matrix.cpp
 
 SOURCE=.\src\shading.cpp
 # End Source File
+# Begin Source File
+
+SOURCE=.\src\stats.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\distributed.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\animation.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\bvh.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\threads.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\wavefront.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\pathtracer.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\budget.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\denoise.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\output.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\sampler.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\arena.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\raydebug.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\regress.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\net.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\server.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\context.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\shadowmap.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\interactive.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\reproject.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\checkpoint.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\adaptive.cpp
+# End Source File
 # End Group
 # Begin Group "Header Files"
 
@@ -165,6 +253,110 @@ SOURCE=.\src\vector.h
 
 SOURCE=.\src\util.h
 # End Source File
+# Begin Source File
+
+SOURCE=.\src\stats.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\distributed.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\animation.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\transform.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\bvh.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\bbox.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\threads.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\wavefront.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\pathtracer.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\random.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\budget.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\denoise.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\output.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\sampler.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\arena.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\scene.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\raydebug.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\regress.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\net.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\server.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\context.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\shadowmap.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\interactive.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\reproject.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\checkpoint.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\adaptive.h
+# End Source File
 # End Group
 # Begin Group "Resource Files"
 
@@ -0,0 +1,214 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2012 by Veselin Georgiev, Slavomir Kaslev et al    *
+ *   admin@raytracing-bg.net                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <stdio.h>
+#include <vector>
+#include "adaptive.h"
+#include "context.h"
+#include "geometry.h"
+#include "shading.h"
+#include "threads.h"
+#include "sampler.h"
+#include "sdl.h"
+using std::vector;
+
+extern Color raytrace(Ray ray);
+extern bool needsAA(const Color* p, int stride, int x, int y);
+
+const int ADAPTIVE_GRID = 4; //!< the spacing of the initial grid (a power of two)
+const float ADAPTIVE_COLOR_THRESH = 0.05f; //!< the largest difference of a corner from the average in a uniform block
+const double ADAPTIVE_NORMAL_COS = 0.95; //!< the smallest cosine between corner normals in a uniform block
+
+/// the states of the samples
+enum {
+	SAMPLE_NONE,
+	SAMPLE_TRACED,
+	SAMPLE_INTERPOLATED
+};
+
+/// the samples (on a lattice, which covers the frame, rounded up to whole grid blocks)
+/// and the state of the refinement
+struct AdaptiveData {
+	int width, height; //!< the lattice size: (a multiple of ADAPTIVE_GRID) + 1
+	vector<Color> color;
+	vector<const Node*> node;
+	vector<Vector> normal;
+	vector<unsigned char> state;
+	int spacing; //!< of the current level
+	int blocksX, blocksY; //!< of the current level
+	vector<unsigned char> uniform; //!< per block of the current level
+	vector<unsigned char> parentUniform; //!< per block of the previous (twice coarser) level
+};
+
+static void traceSample(AdaptiveData& ad, int x, int y)
+{
+	RenderContext& rc = *currentContext;
+	Ray ray = rc.camera.getScreenRay(x, y);
+	IntersectionInfo info;
+	Node* node = rc.bvh.intersect(ray, info);
+	int i = y * ad.width + x;
+	ad.node[i] = node;
+	ad.state[i] = SAMPLE_TRACED;
+	if (node) {
+		ad.color[i] = node->shader->shade(ray, info);
+		ad.normal[i] = info.norm;
+	} else ad.color[i] = Color(0, 0, 0);
+}
+
+static float colorDifference(const Color& a, const Color& b)
+{
+	return fabs(a.r - b.r) + fabs(a.g - b.g) + fabs(a.b - b.b);
+}
+
+/// traces the initial grid: the lattice rows [begin..end) with samples, as a parallelFor() kernel
+static void kernelGrid(int begin, int end, void* data)
+{
+	AdaptiveData& ad = *(AdaptiveData*) data;
+	for (int row = begin; row < end; row++)
+		for (int x = 0; x < ad.width; x += ADAPTIVE_GRID)
+			traceSample(ad, x, row * ADAPTIVE_GRID);
+}
+
+/// decides which blocks of the current level are uniform, for the block rows [begin..end)
+static void kernelClassify(int begin, int end, void* data)
+{
+	AdaptiveData& ad = *(AdaptiveData*) data;
+	int s = ad.spacing, W = ad.width;
+	for (int by = begin; by < end; by++)
+		for (int bx = 0; bx < ad.blocksX; bx++) {
+			unsigned char& result = ad.uniform[by * ad.blocksX + bx];
+			if (s < ADAPTIVE_GRID && ad.parentUniform[(by / 2) * (ad.blocksX / 2) + bx / 2]) {
+				result = 1; // the corners are interpolated
+				continue;
+			}
+			int i = by * s * W + bx * s;
+			int corners[4] = { i, i + s, i + s * W, i + s * W + s };
+			const Node* node = ad.node[i];
+			Color average = (ad.color[corners[0]] + ad.color[corners[1]] + ad.color[corners[2]] + ad.color[corners[3]]) / 4;
+			result = 1;
+			for (int k = 0; result && k < 4; k++) {
+				int c = corners[k];
+				if (ad.node[c] != node || colorDifference(ad.color[c], average) > ADAPTIVE_COLOR_THRESH)
+					result = 0;
+				else if (node && dot(ad.normal[c], ad.normal[i]) < ADAPTIVE_NORMAL_COS)
+					result = 0;
+			}
+		}
+}
+
+/// returns whether the block (bx, by) of the current level is uniform (outside ones are)
+static bool isUniform(const AdaptiveData& ad, int bx, int by)
+{
+	if (bx < 0 || bx >= ad.blocksX || by < 0 || by >= ad.blocksY) return true;
+	return ad.uniform[by * ad.blocksX + bx] != 0;
+}
+
+/// fills in the new samples of the next level (the midpoints between the current level's
+/// ones) in the lattice rows [begin..end) of the next level: interpolated, if all the blocks
+/// they're in are uniform, else traced
+static void kernelRefine(int begin, int end, void* data)
+{
+	AdaptiveData& ad = *(AdaptiveData*) data;
+	int s = ad.spacing, h = s / 2, W = ad.width;
+	for (int row = begin; row < end; row++) {
+		int y = row * h;
+		bool midRow = y % s != 0;
+		for (int x = midRow ? 0 : h; x < W; x += midRow ? h : s) {
+			bool midColumn = x % s != 0;
+			int bx = x / s, by = y / s, i = y * W + x;
+			int a, b; // the samples to interpolate between (and the other two, for the block centers)
+			bool uniform;
+			if (midRow && midColumn) {
+				uniform = isUniform(ad, bx, by);
+				a = i - h * W - h;
+				b = i + h * W + h;
+			} else if (midRow) {
+				uniform = isUniform(ad, bx - 1, by) && isUniform(ad, bx, by);
+				a = i - h * W;
+				b = i + h * W;
+			} else {
+				uniform = isUniform(ad, bx, by - 1) && isUniform(ad, bx, by);
+				a = i - h;
+				b = i + h;
+			}
+			if (!uniform) {
+				traceSample(ad, x, y);
+				continue;
+			}
+			ad.state[i] = SAMPLE_INTERPOLATED;
+			ad.node[i] = ad.node[a];
+			ad.normal[i] = ad.normal[a];
+			if (midRow && midColumn)
+				ad.color[i] = (ad.color[a] + ad.color[b] + ad.color[a + s] + ad.color[b - s]) / 4;
+			else
+				ad.color[i] = (ad.color[a] + ad.color[b]) / 2;
+		}
+	}
+}
+
+/// writes the rows [begin..end) of the frame to the vfb, anti-aliasing the traced pixels, which need it
+static void kernelResolve(int begin, int end, void* data)
+{
+	RenderContext& rc = *currentContext;
+	AdaptiveData& ad = *(AdaptiveData*) data;
+	int W = frameWidth();
+	for (int y = begin; y < end; y++)
+		for (int x = 0; x < W; x++) {
+			int i = y * ad.width + x;
+			if (ad.state[i] == SAMPLE_TRACED && needsAA(&ad.color[i], ad.width, x, y)) {
+				Color accum = Color(0, 0, 0);
+				for (int samples = 0; samples < AA_SAMPLES; samples++) {
+					double dx, dy;
+					getPixelSample(x, y, samples, AA_SAMPLES, dx, dy);
+					accum += raytrace(rc.camera.getScreenRay(x + dx, y + dy));
+				}
+				rc.vfb[y][x] = accum / AA_SAMPLES;
+			} else rc.vfb[y][x] = ad.color[i];
+		}
+}
+
+double renderAdaptive(void)
+{
+	int W = frameWidth(), H = frameHeight();
+	AdaptiveData ad;
+	ad.width = (W - 1 + ADAPTIVE_GRID - 1) / ADAPTIVE_GRID * ADAPTIVE_GRID + 1;
+	ad.height = (H - 1 + ADAPTIVE_GRID - 1) / ADAPTIVE_GRID * ADAPTIVE_GRID + 1;
+	int n = ad.width * ad.height;
+	ad.color.resize(n);
+	ad.node.assign(n, (const Node*) NULL);
+	ad.normal.resize(n);
+	ad.state.assign(n, SAMPLE_NONE);
+	parallelFor((ad.height - 1) / ADAPTIVE_GRID + 1, 4, kernelGrid, &ad);
+	for (ad.spacing = ADAPTIVE_GRID; ad.spacing > 1; ad.spacing /= 2) {
+		ad.blocksX = (ad.width - 1) / ad.spacing;
+		ad.blocksY = (ad.height - 1) / ad.spacing;
+		ad.parentUniform.swap(ad.uniform);
+		ad.uniform.resize(ad.blocksX * ad.blocksY);
+		parallelFor(ad.blocksY, 4, kernelClassify, &ad);
+		parallelFor((ad.height - 1) / (ad.spacing / 2) + 1, 4, kernelRefine, &ad);
+	}
+	parallelFor(H, 4, kernelResolve, &ad);
+	int traced = 0;
+	for (int y = 0; y < H; y++)
+		for (int x = 0; x < W; x++)
+			if (ad.state[y * ad.width + x] == SAMPLE_TRACED) traced++;
+	printf("Adaptive sampling: primary rays for %.1lf%% of the pixels\n", traced * 100.0 / (W * H));
+	return traced / (double) (W * H);
+}
@@ -0,0 +1,36 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2012 by Veselin Georgiev, Slavomir Kaslev et al    *
+ *   admin@raytracing-bg.net                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#ifndef __ADAPTIVE_H__
+#define __ADAPTIVE_H__
+
+/// An alternative to renderScene(), which saves primary rays (and their shading) in flat regions.
+/// First, a sparse grid is traced: every ADAPTIVE_GRID-th pixel in both directions. Then the grid
+/// is refined level by level, halving the spacing each time. A block between four grid samples
+/// is uniform if they hit the same node, with similar normals and colors; the new samples inside
+/// (and on the edges of) uniform blocks are interpolated from the corners, and the sub-blocks stay
+/// uniform. The rest are traced, and their blocks are checked again at the next level. Finally,
+/// the traced pixels are anti-aliased like in renderScene(); the interpolated ones don't need it.
+///
+/// The traced pixels have the same colors as in renderScene(). Details that fit between the grid
+/// samples (e.g., thin objects, or a small shadow on a flat surface) may be missed.
+/// Returns the fraction of the pixels, for which a primary ray was traced.
+double renderAdaptive(void);
+
+#endif // __ADAPTIVE_H__
@@ -0,0 +1,247 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2012 by Veselin Georgiev, Slavomir Kaslev et al    *
+ *   admin@raytracing-bg.net                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <SDL/SDL.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include "animation.h"
+#include "camera.h"
+#include "geometry.h"
+#include "bitmap.h"
+#include "sdl.h"
+#include "bvh.h"
+#include "output.h"
+#include "scene.h"
+#include "context.h"
+using std::vector;
+using std::sort;
+
+extern void renderScene(void);
+extern void nodeChanged(int index);
+
+static bool operator < (const CameraKey& a, const CameraKey& b)
+{
+	return a.frame < b.frame;
+}
+
+static bool operator < (const NodeKey& a, const NodeKey& b)
+{
+	if (a.node != b.node) return a.node < b.node;
+	return a.frame < b.frame;
+}
+
+static inline double lerp(double a, double b, double t) { return a + (b - a) * t; }
+static inline Vector lerp(const Vector& a, const Vector& b, double t) { return a + (b - a) * t; }
+
+/// finds the two keys among keys[begin..end) (sorted by frame) to interpolate between for the
+/// given frame, and the interpolation parameter t in [0..1].
+template <class Key>
+static void findKeys(const vector<Key>& keys, int begin, int end, int frame, int& k0, int& k1, double& t)
+{
+	k0 = k1 = begin;
+	t = 0;
+	if (frame <= keys[begin].frame) return;
+	k0 = k1 = end - 1;
+	if (frame >= keys[end - 1].frame) return;
+	for (int i = begin; i < end - 1; i++) {
+		if (frame < keys[i + 1].frame) {
+			k0 = i;
+			k1 = i + 1;
+			t = (frame - keys[i].frame) / (double) (keys[i + 1].frame - keys[i].frame);
+			return;
+		}
+	}
+}
+
+bool Animation::load(const char* filename)
+{
+	const Scene& scene = currentContext->scene;
+	FILE* f = fopen(filename, "rt");
+	if (!f) {
+		printf("Cannot open animation file `%s'\n", filename);
+		return false;
+	}
+	cameraKeys.clear();
+	nodeKeys.clear();
+	frames = 0;
+	char line[1024];
+	int lineNo = 0;
+	bool ok = true;
+	while (ok && fgets(line, sizeof(line), f)) {
+		lineNo++;
+		char keyword[32];
+		if (sscanf(line, "%31s", keyword) != 1 || keyword[0] == '#') continue;
+		if (!strcmp(keyword, "frames")) {
+			ok = sscanf(line, "%*s %d", &frames) == 1 && frames > 0;
+		} else if (!strcmp(keyword, "camera")) {
+			CameraKey k;
+			ok = sscanf(line, "%*s %d %lf %lf %lf %lf %lf %lf %lf", &k.frame, &k.pos.x, &k.pos.y, &k.pos.z,
+			            &k.yaw, &k.pitch, &k.roll, &k.fov) == 8;
+			if (ok) cameraKeys.push_back(k);
+		} else if (!strcmp(keyword, "node")) {
+			NodeKey k;
+			ok = sscanf(line, "%*s %d %d %lf %lf %lf %lf %lf %lf %lf", &k.node, &k.frame, &k.pos.x, &k.pos.y, &k.pos.z,
+			            &k.yaw, &k.pitch, &k.roll, &k.scale) == 9;
+			if (ok && (k.node < 0 || k.node >= (int) scene.nodes.size())) {
+				printf("%s:%d: no such node: %d\n", filename, lineNo, k.node);
+				fclose(f);
+				return false;
+			}
+			if (ok) nodeKeys.push_back(k);
+		} else ok = false;
+		if (!ok) printf("%s:%d: syntax error\n", filename, lineNo);
+	}
+	fclose(f);
+	if (ok && frames == 0) {
+		printf("%s: the number of frames isn't specified\n", filename);
+		ok = false;
+	}
+	sort(cameraKeys.begin(), cameraKeys.end());
+	sort(nodeKeys.begin(), nodeKeys.end());
+	return ok;
+}
+
+void Animation::setupFrame(int frame) const
+{
+	Camera& camera = currentContext->camera;
+	const Scene& scene = currentContext->scene;
+	int k0, k1;
+	double t;
+	if (!cameraKeys.empty()) {
+		findKeys(cameraKeys, 0, (int) cameraKeys.size(), frame, k0, k1, t);
+		const CameraKey& a = cameraKeys[k0];
+		const CameraKey& b = cameraKeys[k1];
+		camera.pos = lerp(a.pos, b.pos, t);
+		camera.yaw = lerp(a.yaw, b.yaw, t);
+		camera.pitch = lerp(a.pitch, b.pitch, t);
+		camera.roll = lerp(a.roll, b.roll, t);
+		camera.fov = lerp(a.fov, b.fov, t);
+	}
+	camera.beginRender();
+	
+	for (int begin = 0, end; begin < (int) nodeKeys.size(); begin = end) {
+		// keys of a single node:
+		for (end = begin + 1; end < (int) nodeKeys.size() && nodeKeys[end].node == nodeKeys[begin].node; end++);
+		findKeys(nodeKeys, begin, end, frame, k0, k1, t);
+		const NodeKey& a = nodeKeys[k0];
+		const NodeKey& b = nodeKeys[k1];
+		double scale = lerp(a.scale, b.scale, t);
+		Transform& T = scene.nodes[a.node]->T;
+		T.reset();
+		T.scale(scale, scale, scale);
+		T.rotate(lerp(a.yaw, b.yaw, t), lerp(a.pitch, b.pitch, t), lerp(a.roll, b.roll, t));
+		T.translate(lerp(a.pos, b.pos, t));
+		nodeChanged(a.node);
+	}
+}
+
+/// an output buffer. Saving happens in a separate thread, while the next frame is traced.
+struct FrameWriter {
+	vector<unsigned> pixels; //!< the frame, after the output stage
+	int width, height;
+	char filename[1024];
+	SDL_Thread* thread;
+	
+	FrameWriter() { thread = NULL; }
+	/// waits for the previous save to finish; returns false if it failed
+	bool wait(void)
+	{
+		if (!thread) return true;
+		int status;
+		SDL_WaitThread(thread, &status);
+		thread = NULL;
+		return status == 0;
+	}
+};
+
+static int saveFrameThread(void* data)
+{
+	FrameWriter* w = (FrameWriter*) data;
+	if (saveBMP(w->filename, &w->pixels[0], w->width, w->height)) return 0;
+	printf("Cannot save `%s'\n", w->filename);
+	return 1;
+}
+
+/// checks that the output pattern has exactly one integer conversion ("%d", optionally with a
+/// zero-padded width, like "%04d"), and no other '%', except "%%"; the pattern is used as the format
+/// string of snprintf(), so anything else would be undefined behaviour (or name all frames the same)
+static bool checkOutputPattern(const char* pattern)
+{
+	int conversions = 0;
+	for (const char* p = pattern; *p; p++) {
+		if (*p != '%') continue;
+		p++;
+		if (*p == '%') continue;
+		if (*p == '0') p++;
+		while (*p >= '0' && *p <= '9') p++;
+		if (*p != 'd') return false;
+		conversions++;
+	}
+	return conversions == 1;
+}
+
+bool renderAnimation(const char* animFile, const char* outputPattern, bool display)
+{
+	if (!checkOutputPattern(outputPattern)) {
+		printf("Bad output pattern `%s': it needs exactly one frame number (like %%04d), and no other %%\n", outputPattern);
+		return false;
+	}
+	Color (*vfb)[VFB_MAX_SIZE] = currentContext->vfb;
+	const BVH& bvh = currentContext->bvh;
+	Animation anim;
+	if (!anim.load(animFile)) return false;
+	
+	FrameWriter writers[2];
+	bool ok = true;
+	Uint32 start = SDL_GetTicks();
+	int frame;
+	for (frame = 0; ok && frame < anim.getFrameCount(); frame++) {
+		Uint32 frameStart = SDL_GetTicks();
+		anim.setupFrame(frame);
+		currentContext->prepareFrame();
+		renderScene();
+		
+		// hand the frame over to a writer; the one from two frames ago should be done by now:
+		FrameWriter& w = writers[frame % 2];
+		if (!w.wait()) ok = false;
+		w.width = frameWidth();
+		w.height = frameHeight();
+		w.pixels.resize(w.width * w.height);
+		quantizeFrame(vfb, w.width, w.height, &w.pixels[0], w.width);
+		snprintf(w.filename, sizeof(w.filename), outputPattern, frame);
+		w.thread = SDL_CreateThread(saveFrameThread, &w);
+		
+		if (display) {
+			displayVFB(vfb);
+			if (userWantsToQuit()) {
+				frame++;
+				break;
+			}
+		}
+		printf("Frame %d/%d: %.2lf seconds\n", frame + 1, anim.getFrameCount(), (SDL_GetTicks() - frameStart) / 1000.0);
+	}
+	if (!writers[0].wait()) ok = false;
+	if (!writers[1].wait()) ok = false;
+	Uint32 total = SDL_GetTicks() - start;
+	printf("Animation: %d frames in %.2lf seconds (%.2lf fps)\n", frame, total / 1000.0, frame * 1000.0 / (total ? total : 1));
+	printf("BVH: %d node refits, %d rebuilds\n", bvh.refits, bvh.rebuilds);
+	return ok;
+}
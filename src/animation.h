@@ -0,0 +1,76 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2012 by Veselin Georgiev, Slavomir Kaslev et al    *
+ *   admin@raytracing-bg.net                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#ifndef __ANIMATION_H__
+#define __ANIMATION_H__
+
+#include <vector>
+#include "vector.h"
+
+/*
+ * Animation batch mode: renders a sequence of frames from a single scene, which is
+ * generated once and kept in memory. The camera and the node transforms are
+ * interpolated between keyframes, given in a text file like this:
+ *
+ *     # comments start with '#'
+ *     frames 240
+ *     # camera <frame> <x> <y> <z> <yaw> <pitch> <roll> <fov>
+ *     camera 0    -10 100 0    -10 -25 0 90
+ *     camera 239  -10 100 500   10 -25 0 60
+ *     # node <node index> <frame> <x> <y> <z> <yaw> <pitch> <roll> <scale>
+ *     node 1 0    0 0 0     0 0 0  1
+ *     node 1 239  0 50 0   90 0 0  2
+ *
+ * Values are linearly interpolated between keys, and held constant before the first
+ * and after the last one. Nodes without keys, as well as the camera (if it has no keys),
+ * keep their setup from generateScene().
+ */
+
+struct CameraKey {
+	int frame;
+	Vector pos;
+	double yaw, pitch, roll, fov;
+};
+
+struct NodeKey {
+	int node; //!< index in scene.nodes
+	int frame;
+	Vector pos; //!< translation
+	double yaw, pitch, roll; //!< rotation, in degrees
+	double scale; //!< uniform scaling
+};
+
+class Animation {
+	std::vector<CameraKey> cameraKeys; //!< sorted by frame
+	std::vector<NodeKey> nodeKeys; //!< sorted by node, then by frame
+	int frames;
+public:
+	Animation() { frames = 0; }
+	bool load(const char* filename); //!< loads an animation file. Returns false on error
+	int getFrameCount(void) const { return frames; }
+	void setupFrame(int frame) const; //!< sets the camera and the node transforms for the given frame
+};
+
+/// renders all frames of an animation, saving them to files named by the printf-style
+/// pattern `outputPattern' (e.g. "frame_%04d.bmp"), which must have exactly one "%d" (optionally
+/// zero-padded) and no other conversions, except "%%". If `display' is set, each frame is also shown
+/// on screen. Returns false on error (including a bad pattern, which is checked before rendering).
+bool renderAnimation(const char* animFile, const char* outputPattern, bool display);
+
+#endif // __ANIMATION_H__
@@ -0,0 +1,77 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2012 by Veselin Georgiev, Slavomir Kaslev et al    *
+ *   admin@raytracing-bg.net                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <stdlib.h>
+#include <new>
+#include "arena.h"
+
+const size_t FIRST_BLOCK_SIZE = 64 * 1024;
+const size_t MAX_BLOCK_SIZE = 16 * 1024 * 1024;
+const size_t ALIGNMENT = 16;
+
+static inline size_t alignUp(size_t x) { return (x + ALIGNMENT - 1) & ~(ALIGNMENT - 1); }
+
+Arena::Arena()
+{
+	blocks = NULL;
+	cur = end = NULL;
+	nextBlockSize = FIRST_BLOCK_SIZE;
+	used = 0;
+}
+
+void Arena::addBlock(size_t minSize)
+{
+	size_t size = nextBlockSize > minSize ? nextBlockSize : minSize;
+	// the header is padded, so the data is aligned, too:
+	Block* block = (Block*) malloc(alignUp(sizeof(Block)) + size);
+	if (!block) throw std::bad_alloc();
+	block->next = blocks;
+	block->size = size;
+	blocks = block;
+	cur = (char*) block + alignUp(sizeof(Block));
+	end = cur + size;
+	if (nextBlockSize < MAX_BLOCK_SIZE) nextBlockSize *= 2;
+}
+
+void* Arena::allocate(size_t size)
+{
+	size = alignUp(size ? size : 1);
+	if ((size_t) (end - cur) < size) addBlock(size);
+	void* result = cur;
+	cur += size;
+	used += size;
+	return result;
+}
+
+void Arena::clear(void)
+{
+	// destroy in the reverse order of creation, as objects may refer to earlier ones:
+	for (int i = (int) cleanups.size() - 1; i >= 0; i--)
+		cleanups[i].destroy(cleanups[i].object);
+	cleanups.clear();
+	while (blocks) {
+		Block* next = blocks->next;
+		free(blocks);
+		blocks = next;
+	}
+	cur = end = NULL;
+	nextBlockSize = FIRST_BLOCK_SIZE;
+	used = 0;
+}
@@ -0,0 +1,75 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2012 by Veselin Georgiev, Slavomir Kaslev et al    *
+ *   admin@raytracing-bg.net                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include <stddef.h>
+#include <vector>
+
+/// A bump allocator: objects are placed one after another in large blocks, and are all freed
+/// at once, by clear(). Allocate with placement new: `new (arena) Sphere(...)'; never delete
+/// such objects.
+/// Destructors don't run on clear(), except for the objects, registered with track() - those,
+/// which own memory outside the arena (e.g., a BitmapTexture's bitmap).
+class Arena {
+	struct Block {
+		Block* next;
+		size_t size; //!< of the data, which follows this header
+	};
+	struct Cleanup {
+		void (*destroy)(void* object);
+		void* object;
+	};
+	Block* blocks; //!< the current one first
+	char* cur, *end; //!< the free space in the current block
+	size_t nextBlockSize;
+	size_t used;
+	std::vector<Cleanup> cleanups;
+	
+	template <class T> static void destroyObject(void* object) { ((T*) object)->~T(); }
+	void addBlock(size_t minSize);
+	// not copyable:
+	Arena(const Arena&);
+	void operator = (const Arena&);
+public:
+	Arena();
+	~Arena() { clear(); }
+	
+	void* allocate(size_t size); //!< returns `size' bytes, aligned for any type
+	
+	/// registers an object (allocated in the arena) to be destroyed on clear(). Returns the object.
+	template <class T> T* track(T* object)
+	{
+		Cleanup c = { destroyObject<T>, object };
+		cleanups.push_back(c);
+		return object;
+	}
+	
+	/// frees all objects. The cost doesn't depend on how many objects there are (only on
+	/// the number of blocks, which grow exponentially, and of the tracked objects).
+	void clear(void);
+	
+	size_t bytesUsed(void) const { return used; } //!< the total size of the allocations so far
+};
+
+inline void* operator new(size_t size, Arena& arena) { return arena.allocate(size); }
+inline void operator delete(void*, Arena&) {} // only called if a constructor throws
+
+#endif // __ARENA_H__
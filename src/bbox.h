@@ -0,0 +1,88 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2012 by Veselin Georgiev, Slavomir Kaslev et al    *
+ *   admin@raytracing-bg.net                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#ifndef __BBOX_H__
+#define __BBOX_H__
+
+#include "vector.h"
+#include "constants.h"
+
+/// An axis-aligned bounding box
+struct BBox {
+	Vector vmin, vmax;
+	
+	void makeEmpty(void)
+	{
+		vmin.set(INF, INF, INF);
+		vmax.set(-INF, -INF, -INF);
+	}
+	bool isEmpty(void) const { return vmin.x > vmax.x; }
+	
+	/// extends the box so that it contains the point p
+	void add(const Vector& p)
+	{
+		if (p.x < vmin.x) vmin.x = p.x;
+		if (p.y < vmin.y) vmin.y = p.y;
+		if (p.z < vmin.z) vmin.z = p.z;
+		if (p.x > vmax.x) vmax.x = p.x;
+		if (p.y > vmax.y) vmax.y = p.y;
+		if (p.z > vmax.z) vmax.z = p.z;
+	}
+	/// extends the box so that it contains the box b
+	void add(const BBox& b)
+	{
+		if (b.isEmpty()) return;
+		add(b.vmin);
+		add(b.vmax);
+	}
+	
+	Vector center(void) const { return (vmin + vmax) * 0.5; }
+	
+	double surfaceArea(void) const
+	{
+		if (isEmpty()) return 0;
+		Vector d = vmax - vmin;
+		return 2 * (d.x * d.y + d.y * d.z + d.z * d.x);
+	}
+	
+	bool operator == (const BBox& b) const
+	{
+		return vmin.x == b.vmin.x && vmin.y == b.vmin.y && vmin.z == b.vmin.z &&
+		       vmax.x == b.vmax.x && vmax.y == b.vmax.y && vmax.z == b.vmax.z;
+	}
+	
+	/// tests whether a ray hits the box closer than maxDist (the "slab" method).
+	/// invDir holds the reciprocals of the ray direction components.
+	bool testIntersect(const Ray& ray, const Vector& invDir, double maxDist) const
+	{
+		double t1 = (vmin.x - ray.start.x) * invDir.x, t2 = (vmax.x - ray.start.x) * invDir.x;
+		double tNear = t1 < t2 ? t1 : t2, tFar = t1 < t2 ? t2 : t1;
+		t1 = (vmin.y - ray.start.y) * invDir.y; t2 = (vmax.y - ray.start.y) * invDir.y;
+		if (t1 > t2) { double t = t1; t1 = t2; t2 = t; }
+		if (t1 > tNear) tNear = t1;
+		if (t2 < tFar) tFar = t2;
+		t1 = (vmin.z - ray.start.z) * invDir.z; t2 = (vmax.z - ray.start.z) * invDir.z;
+		if (t1 > t2) { double t = t1; t1 = t2; t2 = t; }
+		if (t1 > tNear) tNear = t1;
+		if (t2 < tFar) tFar = t2;
+		return tNear <= tFar && tFar >= 0 && tNear < maxDist;
+	}
+};
+
+#endif // __BBOX_H__
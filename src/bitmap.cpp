@@ -187,18 +187,111 @@ bool Bitmap::loadBMP(const char* filename)
 }
 
 bool Bitmap::saveBMP(const char* filename)
+{
+	unsigned* pixels = new unsigned[width * height];
+	for (int y = 0; y < height; y++)
+		for (int x = 0; x < width; x++)
+			pixels[y * width + x] = getPixel(x, y).toRGB32();
+	bool result = ::saveBMP(filename, pixels, width, height);
+	delete [] pixels;
+	return result;
+}
+
+static bool isLittleEndian(void)
+{
+	unsigned x = 1;
+	return *(unsigned char*) &x == 1;
+}
+
+static void swapBytes(float* values, int n)
+{
+	for (int i = 0; i < n; i++) {
+		unsigned char* p = (unsigned char*) &values[i];
+		unsigned char t;
+		t = p[0]; p[0] = p[3]; p[3] = t;
+		t = p[1]; p[1] = p[2]; p[2] = t;
+	}
+}
+
+bool Bitmap::loadPFM(const char* filename)
+{
+	freeMem();
+	ImageOpenRAII helper(this);
+	
+	FILE* fp = fopen(filename, "rb");
+	if (fp == NULL) {
+		printf("loadPFM: Can't open file: `%s'\n", filename);
+		return false;
+	}
+	helper.fp = fp;
+	char sign[3] = { 0 };
+	int w, h;
+	float scale;
+	// the header is "PF" (color) or "Pf" (grayscale), the dimensions, and the scale, whose sign
+	// gives the byte order (negative means little-endian). A single whitespace char precedes the data.
+	if (fscanf(fp, "%2s %d %d %f", sign, &w, &h, &scale) != 4 || fgetc(fp) == EOF
+	    || sign[0] != 'P' || (sign[1] != 'F' && sign[1] != 'f')) {
+		printf("loadPFM: `%s' is not a PFM file.\n", filename);
+		return false;
+	}
+	int channels = sign[1] == 'F' ? 3 : 1;
+	generateEmptyImage(w, h);
+	if (!isOK()) {
+		printf("loadPFM: bad image dimensions in `%s'\n", filename);
+		return false;
+	}
+	bool swap = (scale < 0) != isLittleEndian();
+	float* row = new float[w * channels];
+	for (int y = h - 1; y >= 0; y--) { // the rows are stored bottom to top
+		if (fread(row, sizeof(float) * channels, w, fp) != (size_t) w) {
+			printf("loadPFM: short read while opening `%s', file is probably incomplete!\n", filename);
+			delete [] row;
+			return false;
+		}
+		if (swap) swapBytes(row, w * channels);
+		for (int x = 0; x < w; x++) {
+			if (channels == 3) setPixel(x, y, Color(row[x * 3], row[x * 3 + 1], row[x * 3 + 2]));
+			else setPixel(x, y, Color(row[x], row[x], row[x]));
+		}
+	}
+	delete [] row;
+	
+	helper.imageIsOk = true;
+	return true;
+}
+
+bool Bitmap::savePFM(const char* filename)
+{
+	FILE* fp = fopen(filename, "wb");
+	if (!fp) return false;
+	fprintf(fp, "PF\n%d %d\n%s\n", width, height, isLittleEndian() ? "-1.0" : "1.0");
+	float* row = new float[width * 3];
+	bool ok = true;
+	for (int y = height - 1; ok && y >= 0; y--) { // the rows are stored bottom to top
+		for (int x = 0; x < width; x++) {
+			const Color& c = data[y * width + x];
+			row[x * 3] = c.r; row[x * 3 + 1] = c.g; row[x * 3 + 2] = c.b;
+		}
+		ok = fwrite(row, sizeof(float) * 3, width, fp) == (size_t) width;
+	}
+	delete [] row;
+	fclose(fp);
+	return ok;
+}
+
+bool saveBMP(const char* filename, const unsigned* pixels, int width, int height)
 {
 	FILE* fp = fopen(filename, "wb");
 	if (!fp) return false;
 	BmpHeader hd;
 	BmpInfoHeader hi;
-	char xx[VFB_MAX_SIZE * 3];
-
 
 	// fill in the header:
 	int rowsz = width * 3;
 	if (rowsz % 4)
 		rowsz += 4 - (rowsz % 4); // each row in of the image should be filled with zeroes to the next multiple-of-four boundary
+	unsigned char* xx = new unsigned char[rowsz];
+	memset(xx, 0, rowsz);
 	hd.fs = rowsz * height + 54; //std image size
 	hd.lzero = 0;
 	hd.bfImgOffset = 54;
@@ -215,14 +308,16 @@ bool Bitmap::saveBMP(const char* filename)
 	fwrite(&hd, sizeof(hd), 1, fp); // write file header
 	fwrite(&hi, sizeof(hi), 1, fp); // write image header
 	for (int y = height - 1; y >= 0; y--) {
+		const unsigned* row = pixels + y * width;
 		for (int x = 0; x < width; x++) {
-			unsigned t = getPixel(x, y).toRGB32();
+			unsigned t = row[x];
 			xx[x * 3    ] = (0xff     & t);
 			xx[x * 3 + 1] = (0xff00   & t) >> 8;
 			xx[x * 3 + 2] = (0xff0000 & t) >> 16;
 		}
 		fwrite(xx, rowsz, 1, fp);
 	}
+	delete [] xx;
 	fclose(fp);
 	return true;
 }
@@ -40,6 +40,12 @@ public:
 	
 	bool loadBMP(const char* filename); //!< Loads an image from a BMP file. Returns false in the case of an error
 	bool saveBMP(const char* filename); //!< Saves the image to a BMP file (with clamping, etc). Returns false in the case of an error (e.g. read-only media)
+	bool loadPFM(const char* filename); //!< Loads a floating-point image from a PFM file (color or grayscale). Returns false in the case of an error
+	bool savePFM(const char* filename); //!< Saves the image to a PFM file, without any clamping. Returns false in the case of an error
 };
 
+/// saves an image, which is already converted to RGB32 (blue in the least-significant byte,
+/// rows are `width' pixels apart), to a BMP file. Returns false in the case of an error
+bool saveBMP(const char* filename, const unsigned* pixels, int width, int height);
+
 #endif // __BITMAP_H__
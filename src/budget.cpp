@@ -0,0 +1,160 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2012 by Veselin Georgiev, Slavomir Kaslev et al    *
+ *   admin@raytracing-bg.net                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <SDL/SDL.h>
+#include <stdio.h>
+#include <vector>
+#include <algorithm>
+#include "budget.h"
+#include "camera.h"
+#include "threads.h"
+#include "sdl.h"
+#include "sampler.h"
+#include "context.h"
+using std::vector;
+using std::stable_sort;
+
+extern Color raytrace(Ray ray);
+extern Color raytracePrimary(Ray ray, int x, int y);
+extern bool needsAA(const Color* p, int stride, int x, int y);
+extern float aaContrast(const Color* p, int stride, int x, int y);
+
+const int SUPERSAMPLES = 16; //!< samples per pixel at level 2
+const int REFINE_CHUNK = 16; //!< pixels per parallelFor() chunk during refinement
+
+/// a pixel, waiting for refinement
+struct RefineCandidate {
+	float contrast;
+	int x, y;
+	bool operator < (const RefineCandidate& rhs) const { return contrast > rhs.contrast; } // larger first
+};
+
+struct BudgetData {
+	Color* prim; //!< the first pass
+	int width;
+	vector<RefineCandidate> candidates;
+	vector<unsigned char> refined; //!< per candidate: whether the current level got to it
+	Uint32 deadline; //!< in SDL_GetTicks() time
+};
+
+static void kernelFirstPass(int begin, int end, void* data)
+{
+	Camera& camera = currentContext->camera;
+	BudgetData* bd = (BudgetData*) data;
+	for (int y = begin; y < end; y++) {
+		Color* row = bd->prim + y * bd->width;
+		for (int x = 0; x < bd->width; x++)
+			row[x] = raytracePrimary(camera.getScreenRay(x, y), x, y);
+	}
+}
+
+/// averages `count' samples of the pixel, placed by the sampler (like renderScene()'s AA)
+static Color supersample(int x, int y, int count)
+{
+	Camera& camera = currentContext->camera;
+	Color accum(0, 0, 0);
+	for (int i = 0; i < count; i++) {
+		double dx, dy;
+		getPixelSample(x, y, i, count, dx, dy);
+		accum += raytrace(camera.getScreenRay(x + dx, y + dy));
+	}
+	return accum / count;
+}
+
+static void kernelAntialias(int begin, int end, void* data)
+{
+	Color (*vfb)[VFB_MAX_SIZE] = currentContext->vfb;
+	BudgetData* bd = (BudgetData*) data;
+	for (int i = begin; i < end; i++) {
+		if (SDL_GetTicks() >= bd->deadline) return;
+		int x = bd->candidates[i].x, y = bd->candidates[i].y;
+		vfb[y][x] = supersample(x, y, AA_SAMPLES);
+		bd->refined[i] = 1;
+	}
+}
+
+static void kernelSupersample(int begin, int end, void* data)
+{
+	Color (*vfb)[VFB_MAX_SIZE] = currentContext->vfb;
+	BudgetData* bd = (BudgetData*) data;
+	for (int i = begin; i < end; i++) {
+		if (SDL_GetTicks() >= bd->deadline) return;
+		int x = bd->candidates[i].x, y = bd->candidates[i].y;
+		vfb[y][x] = supersample(x, y, SUPERSAMPLES);
+		bd->refined[i] = 1;
+	}
+}
+
+/// runs a refinement level over the candidates; returns how many of them got refined
+static int refine(BudgetData& bd, ParallelKernel kernel)
+{
+	int n = (int) bd.candidates.size();
+	bd.refined.assign(n, 0);
+	parallelFor(n, REFINE_CHUNK, kernel, &bd);
+	int done = 0;
+	for (int i = 0; i < n; i++) done += bd.refined[i];
+	return done;
+}
+
+double renderBudgeted(double seconds)
+{
+	Color (*vfb)[VFB_MAX_SIZE] = currentContext->vfb;
+	Uint32 start = SDL_GetTicks();
+	int W = frameWidth(), H = frameHeight();
+	vector<Color> prim(W * H);
+	BudgetData bd;
+	bd.prim = &prim[0];
+	bd.width = W;
+	bd.deadline = start + (Uint32) (seconds * 1000);
+	
+	currentContext->camera.beginRender();
+	parallelFor(H, 1, kernelFirstPass, &bd);
+	for (int y = 0; y < H; y++)
+		for (int x = 0; x < W; x++)
+			vfb[y][x] = prim[y * W + x];
+	Uint32 firstPass = SDL_GetTicks() - start;
+	
+	for (int y = 0; y < H; y++)
+		for (int x = 0; x < W; x++) {
+			const Color* p = &prim[y * W + x];
+			if (!needsAA(p, W, x, y)) continue;
+			RefineCandidate c;
+			c.contrast = aaContrast(p, W, x, y);
+			c.x = x;
+			c.y = y;
+			bd.candidates.push_back(c);
+		}
+	// stable, so ties keep the scanline order:
+	stable_sort(bd.candidates.begin(), bd.candidates.end());
+	int n = (int) bd.candidates.size();
+	
+	int antialiased = refine(bd, kernelAntialias);
+	int supersampled = 0;
+	if (antialiased == n) supersampled = refine(bd, kernelSupersample);
+	
+	double quality = 1;
+	if (n > 0) quality += (antialiased + supersampled) / (double) n;
+	else quality = 3; // nothing to refine
+	printf("Time budget: %.2lf s, used: %.2lf s (first pass: %.2lf s)\n",
+		seconds, (SDL_GetTicks() - start) / 1000.0, firstPass / 1000.0);
+	printf("Quality level: %.2lf (AA: %d of %d pixels, %dx supersampling: %d of %d pixels)\n",
+		quality, antialiased, n, SUPERSAMPLES, supersampled, n);
+	return quality;
+}
@@ -0,0 +1,35 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2012 by Veselin Georgiev, Slavomir Kaslev et al    *
+ *   admin@raytracing-bg.net                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#ifndef __BUDGET_H__
+#define __BUDGET_H__
+
+/// An alternative to renderScene(), which finishes within a wall-clock budget (in seconds).
+/// First, one ray per pixel is traced - this pass is always done, even if it takes longer than
+/// the budget. The rest of the time goes to refinement, in levels:
+///   1. anti-aliasing, exactly like renderScene()'s;
+///   2. 16x supersampling (with the same sampler, see sampler.h).
+/// Both are only applied to the pixels which need AA, starting with those that differ the most
+/// from their neighbours (where the error of the first pass is the largest). The refinement
+/// stops at the deadline, and the vfb keeps the best image so far. If the time is enough
+/// for level 1, the result is the same as renderScene()'s.
+/// Returns the quality level reached: 1 for the first pass, plus the done fraction of each level.
+double renderBudgeted(double seconds);
+
+#endif // __BUDGET_H__
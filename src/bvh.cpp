@@ -0,0 +1,363 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2012 by Veselin Georgiev, Slavomir Kaslev et al    *
+ *   admin@raytracing-bg.net                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <algorithm>
+#include "bvh.h"
+#include "raydebug.h"
+#include "stats.h"
+using std::vector;
+using std::nth_element;
+
+// relative costs of traversing a BVH node and intersecting a scene node, for the SAH
+const double COST_TRAVERSAL = 1.0;
+const double COST_INTERSECT = 2.0;
+const int MAX_DEPTH = 64;
+
+/// orders items by the centroids of their boxes along an axis
+struct CentroidLess {
+	const vector<BBox>* boxes;
+	int axis;
+	bool operator () (int a, int b) const
+	{
+		Vector ca = (*boxes)[a].center(), cb = (*boxes)[b].center();
+		if (axis == 0) return ca.x < cb.x;
+		if (axis == 1) return ca.y < cb.y;
+		return ca.z < cb.z;
+	}
+};
+
+BVH::BVH()
+{
+	items = NULL;
+	nItems = 0;
+	sahSum = builtCost = 0;
+	rebuildThreshold = 1.5;
+	refits = rebuilds = 0;
+}
+
+void BVH::clear(void)
+{
+	tree.clear();
+	leafOf.clear();
+	unbounded.clear();
+	items = NULL;
+	nItems = 0;
+	sahSum = builtCost = 0;
+}
+
+double BVH::nodeCost(int index) const
+{
+	const BVHNode& n = tree[index];
+	return n.box.surfaceArea() * (n.left == -1 ? COST_INTERSECT : COST_TRAVERSAL);
+}
+
+double BVH::cost(void) const
+{
+	if (tree.empty()) return 0;
+	double rootArea = tree[0].box.surfaceArea();
+	return rootArea > 0 ? sahSum / rootArea : 0;
+}
+
+int BVH::buildNode(int* begin, int* end, int parent, const vector<BBox>& boxes)
+{
+	int index = (int) tree.size();
+	tree.push_back(BVHNode());
+	tree[index].parent = parent;
+	tree[index].left = tree[index].right = tree[index].item = -1;
+	if (end - begin == 1) {
+		tree[index].box = boxes[*begin];
+		tree[index].item = *begin;
+		leafOf[*begin] = index;
+	} else {
+		// split at the median along the longest axis of the centroids' extent:
+		BBox centroids;
+		centroids.makeEmpty();
+		for (int* i = begin; i < end; i++) centroids.add(boxes[*i].center());
+		Vector extent = centroids.vmax - centroids.vmin;
+		CentroidLess less;
+		less.boxes = &boxes;
+		less.axis = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : (extent.y >= extent.z ? 1 : 2);
+		int* mid = begin + (end - begin) / 2;
+		nth_element(begin, mid, end, less);
+		int left = buildNode(begin, mid, index, boxes);
+		int right = buildNode(mid, end, index, boxes);
+		// (tree[] might have been reallocated in the meantime)
+		tree[index].left = left;
+		tree[index].right = right;
+		tree[index].box = tree[left].box;
+		tree[index].box.add(tree[right].box);
+	}
+	sahSum += nodeCost(index);
+	return index;
+}
+
+void BVH::build(Node** nodes, int count)
+{
+	clear();
+	items = nodes;
+	nItems = count;
+	leafOf.assign(count, -1);
+	vector<BBox> boxes(count);
+	vector<int> bounded;
+	for (int i = 0; i < count; i++) {
+		if (nodes[i]->getBounds(boxes[i])) bounded.push_back(i);
+		else unbounded.push_back(i);
+	}
+	if (!bounded.empty()) {
+		tree.reserve(2 * bounded.size());
+		buildNode(&bounded[0], &bounded[0] + bounded.size(), -1, boxes);
+	}
+	builtCost = cost();
+}
+
+void BVH::refit(int index)
+{
+	if (index < 0 || index >= nItems) return;
+	refits++;
+	BBox box;
+	bool bounded = items[index]->getBounds(box);
+	int leaf = leafOf[index];
+	if (leaf == -1 || !bounded) {
+		// the node changed between bounded and unbounded (or was unbounded and still is):
+		if (leaf != -1 || bounded) {
+			build(items, nItems);
+			rebuilds++;
+		}
+		return;
+	}
+	// walk up to the root, stopping as soon as a box doesn't change:
+	for (int i = leaf; i != -1; i = tree[i].parent) {
+		BVHNode& n = tree[i];
+		if (n.left != -1) {
+			box = tree[n.left].box;
+			box.add(tree[n.right].box);
+		}
+		if (box == n.box) break;
+		sahSum -= nodeCost(i);
+		n.box = box;
+		sahSum += nodeCost(i);
+	}
+	if (cost() > builtCost * rebuildThreshold) {
+		build(items, nItems);
+		rebuilds++;
+	}
+}
+
+static inline Vector reciprocal(const Vector& v)
+{
+	return Vector(1.0 / v.x, 1.0 / v.y, 1.0 / v.z);
+}
+
+Node* BVH::intersect(const Ray& ray, IntersectionInfo& info) const
+{
+	threadStats.rays++;
+	Node* closest = NULL;
+	HitRecord best;
+	best.distance = INF;
+	// planes and such go first, as they usually yield a closer maximum distance for the tree traversal:
+	for (int i = 0; i < (int) unbounded.size(); i++) {
+		HitRecord temp;
+		Node* node = items[unbounded[i]];
+		threadStats.intersectionTests++;
+		bool found = node->findHit(ray, temp);
+		RAY_TREE(candidate(node, found, temp));
+		if (found && temp.distance < best.distance) {
+			best = temp;
+			closest = node;
+		}
+	}
+	if (!tree.empty()) {
+		Vector invDir = reciprocal(ray.dir);
+		int stack[MAX_DEPTH];
+		int sp = 0;
+		stack[sp++] = 0;
+		while (sp > 0) {
+			const BVHNode& n = tree[stack[--sp]];
+			if (!n.box.testIntersect(ray, invDir, best.distance)) continue;
+			if (n.left == -1) {
+				HitRecord temp;
+				Node* node = items[n.item];
+				threadStats.intersectionTests++;
+				bool found = node->findHit(ray, temp);
+				RAY_TREE(candidate(node, found, temp));
+				if (found && temp.distance < best.distance) {
+					best = temp;
+					closest = node;
+				}
+			} else {
+				stack[sp++] = n.right;
+				stack[sp++] = n.left;
+			}
+		}
+	}
+	// only the closest hit gets the full info:
+	if (closest) closest->fillInfo(ray, best, info);
+	else info.distance = INF;
+	return closest;
+}
+
+Node* BVH::findOccluder(const Ray& ray, double maxDist, Node* skip) const
+{
+	for (int i = 0; i < (int) unbounded.size(); i++) {
+		HitRecord hit;
+		Node* node = items[unbounded[i]];
+		if (node == skip) continue;
+		threadStats.intersectionTests++;
+		bool found = node->findHit(ray, hit);
+		RAY_TREE(candidate(node, found, hit));
+		if (found && hit.distance < maxDist) return node;
+	}
+	if (tree.empty()) return NULL;
+	Vector invDir = reciprocal(ray.dir);
+	int stack[MAX_DEPTH];
+	int sp = 0;
+	stack[sp++] = 0;
+	while (sp > 0) {
+		const BVHNode& n = tree[stack[--sp]];
+		if (!n.box.testIntersect(ray, invDir, maxDist)) continue;
+		if (n.left == -1) {
+			HitRecord hit;
+			Node* node = items[n.item];
+			if (node == skip) continue;
+			threadStats.intersectionTests++;
+			bool found = node->findHit(ray, hit);
+			RAY_TREE(candidate(node, found, hit));
+			if (found && hit.distance < maxDist) return node;
+		} else {
+			stack[sp++] = n.right;
+			stack[sp++] = n.left;
+		}
+	}
+	return NULL;
+}
+
+/// The bounding cone of a packet of rays with a common origin (its apex): it contains every ray,
+/// up to the distance `reach' from the apex.
+struct PacketCone {
+	Vector apex, axis;
+	double cosHalf, sinHalf; //!< of the half-angle
+	double reach;
+	bool valid; //!< false if the rays are too spread for a cone (every box is then inside)
+	
+	/// tests whether a box is entirely outside the cone. Conservative: the box is replaced by
+	/// its bounding sphere, which is outside if the angle between its center and the axis
+	/// exceeds the half-angle plus the angle, the sphere subtends.
+	bool excludes(const BBox& box) const
+	{
+		if (!valid) return false;
+		Vector center = box.center();
+		double radius = (box.vmax - center).length();
+		Vector d = center - apex;
+		double dist = d.length();
+		if (dist <= radius) return false; // the apex is inside
+		if (dist - radius > reach) return true;
+		double sinSphere = radius / dist, cosSphere = sqrt(1 - sinSphere * sinSphere);
+		// (both angles are below 90 degrees, so the cosine of their sum decreases monotonically)
+		double cosSum = cosHalf * cosSphere - sinHalf * sinSphere;
+		return dot(d, axis) < cosSum * dist;
+	}
+};
+
+Node* BVH::findOccluders(const Vector& origin, const Vector* dirs, const double* maxDist, int count,
+                        unsigned char* occluded) const
+{
+	int active = count; //!< rays, not occluded so far
+	Node* occluder = NULL;
+	for (int i = 0; i < count; i++) occluded[i] = 0;
+	for (int k = 0; k < (int) unbounded.size() && active > 0; k++) {
+		Node* node = items[unbounded[k]];
+		for (int i = 0; i < count; i++) {
+			if (occluded[i]) continue;
+			HitRecord hit;
+			threadStats.intersectionTests++;
+			if (node->findHit(Ray(origin, dirs[i]), hit) && hit.distance < maxDist[i]) {
+				occluded[i] = 1;
+				active--;
+				occluder = node;
+			}
+		}
+	}
+	if (tree.empty() || active == 0) return occluder;
+	
+	// the bounding cone of the rays, which are left:
+	PacketCone cone;
+	cone.apex = origin;
+	cone.axis = Vector(0, 0, 0);
+	cone.reach = 0;
+	Vector invDir[MAX_PACKET_SIZE];
+	for (int i = 0; i < count; i++) {
+		invDir[i] = reciprocal(dirs[i]);
+		if (occluded[i]) continue;
+		cone.axis = cone.axis + dirs[i];
+		if (maxDist[i] > cone.reach) cone.reach = maxDist[i];
+	}
+	cone.cosHalf = 1;
+	cone.sinHalf = 0;
+	cone.valid = cone.axis.length() > 1e-9;
+	if (cone.valid) {
+		cone.axis.normalize();
+		for (int i = 0; i < count; i++)
+			if (!occluded[i] && dot(cone.axis, dirs[i]) < cone.cosHalf) cone.cosHalf = dot(cone.axis, dirs[i]);
+		cone.valid = cone.cosHalf > 0; // (up to 90 degrees)
+		cone.sinHalf = sqrt(1 - cone.cosHalf * cone.cosHalf);
+	}
+	
+	// every stack entry also holds the first ray, which may hit the node (the ones before it missed its parent):
+	int stack[MAX_DEPTH], firstRay[MAX_DEPTH];
+	int sp = 0;
+	stack[sp] = 0;
+	firstRay[sp++] = 0;
+	while (sp > 0 && active > 0) {
+		sp--;
+		const BVHNode& n = tree[stack[sp]];
+		int first = firstRay[sp];
+		while (first < count && occluded[first]) first++;
+		if (first == count) continue;
+		// usually, the first ray hits the box; if it doesn't, try to reject the box with the cone,
+		// before looking for another ray, which hits it:
+		if (!n.box.testIntersect(Ray(origin, dirs[first]), invDir[first], maxDist[first])) {
+			if (cone.excludes(n.box)) continue;
+			for (first++; first < count; first++)
+				if (!occluded[first] && n.box.testIntersect(Ray(origin, dirs[first]), invDir[first], maxDist[first])) break;
+			if (first == count) continue;
+		}
+		if (n.left == -1) {
+			Node* node = items[n.item];
+			for (int i = first; i < count; i++) {
+				if (occluded[i]) continue;
+				Ray ray(origin, dirs[i]);
+				if (i != first && !n.box.testIntersect(ray, invDir[i], maxDist[i])) continue;
+				HitRecord hit;
+				threadStats.intersectionTests++;
+				if (node->findHit(ray, hit) && hit.distance < maxDist[i]) {
+					occluded[i] = 1;
+					active--;
+					occluder = node;
+				}
+			}
+		} else {
+			stack[sp] = n.right;
+			firstRay[sp++] = first;
+			stack[sp] = n.left;
+			firstRay[sp++] = first;
+		}
+	}
+	return occluder;
+}
@@ -0,0 +1,84 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2012 by Veselin Georgiev, Slavomir Kaslev et al    *
+ *   admin@raytracing-bg.net                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#ifndef __BVH_H__
+#define __BVH_H__
+
+#include <vector>
+#include "bbox.h"
+#include "geometry.h"
+
+const int MAX_PACKET_SIZE = 64; //!< the most rays, BVH::findOccluders() takes at once
+
+/// A bounding volume hierarchy over the nodes of the scene. Nodes without bounds
+/// (e.g. planes) are kept aside and tested against every ray.
+///
+/// When a node moves or changes, refit() updates the boxes on the path from its leaf to the
+/// root, in time proportional to the depth of the tree. The quality of the tree is tracked
+/// via its SAH cost, and if refitting degrades it past rebuildThreshold (compared to
+/// the freshly-built tree), the whole tree is rebuilt.
+class BVH {
+	struct BVHNode {
+		BBox box;
+		int left, right; //!< children (-1 for leaves)
+		int parent; //!< -1 for the root
+		int item; //!< for leaves: index of the scene node
+	};
+	std::vector<BVHNode> tree; //!< tree[0] is the root
+	std::vector<int> leafOf; //!< for each item: index of its leaf in tree[] (-1 for unbounded items)
+	std::vector<int> unbounded; //!< items without bounds
+	Node** items;
+	int nItems;
+	double sahSum; //!< sum of the SAH cost terms of all tree nodes (not normalized)
+	double builtCost; //!< normalized SAH cost, right after the build
+	
+	int buildNode(int* begin, int* end, int parent, const std::vector<BBox>& boxes);
+	double nodeCost(int index) const; //!< the contribution of a tree node to sahSum
+public:
+	double rebuildThreshold; //!< rebuild when cost() exceeds the initial cost by that factor
+	int refits, rebuilds; //!< counters, for the curious
+	
+	BVH();
+	void build(Node** nodes, int count); //!< (re)builds the tree over the given nodes
+	void clear(void);
+	
+	/// call after node #index has changed (e.g., its transform). Refits the tree and,
+	/// if its quality has degraded too much, rebuilds it.
+	void refit(int index);
+	
+	double cost(void) const; //!< the current SAH cost of the tree, normalized by the root's area
+	
+	/// finds the closest node, intersected by the ray. Returns NULL if there's no intersection. Only the
+	/// closest of the candidate hits gets its info computed (see Geometry::fillInfo())
+	Node* intersect(const Ray& ray, IntersectionInfo& info) const;
+	
+	/// finds any node (other than `skip'), which is intersected by the ray closer than maxDist.
+	/// Returns NULL if there's no such node.
+	Node* findOccluder(const Ray& ray, double maxDist, Node* skip) const;
+	
+	/// like findOccluder(), for a packet of up to MAX_PACKET_SIZE rays, which share their origin
+	/// (e.g. shadow rays, starting at a point light): sets occluded[i] if ray i hits something closer
+	/// than maxDist[i]. The packet traverses the tree as a whole: a subtree is skipped if its box is
+	/// outside the packet's bounding cone, or none of the rays, which are still unoccluded, hits it.
+	/// Returns the last node, found to occlude a ray (NULL if none).
+	Node* findOccluders(const Vector& origin, const Vector* dirs, const double* maxDist, int count,
+	                   unsigned char* occluded) const;
+};
+
+#endif // __BVH_H__
@@ -64,3 +64,39 @@ Ray Camera::getScreenRay(double x, double y)
 	return result;
 }
 
+bool Camera::project(const Vector& p, double& x, double& y) const
+{
+	// p - pos = t * (upLeft - pos + u * U + v * V), where U and V are the screen edges (perpendicular
+	// to each other), and u = x / frameWidth(), v = y / frameHeight():
+	Vector U = upRight - upLeft, V = downLeft - upLeft;
+	Vector n = U ^ V; // the normal of the screen
+	Vector d = p - pos, A = upLeft - pos;
+	double t = dot(d, n) / dot(A, n);
+	if (t <= 0) return false;
+	Vector q = d / t - A;
+	x = dot(q, U) / U.lengthSqr() * frameWidth();
+	y = dot(q, V) / V.lengthSqr() * frameHeight();
+	return true;
+}
+
+Vector Camera::getFrontDir() const
+{
+	// the screen is a parallelogram, so its center is halfway between the opposite corners:
+	Vector result = (upRight + downLeft) * 0.5 - pos;
+	result.normalize();
+	return result;
+}
+
+Vector Camera::getRightDir() const
+{
+	Vector result = upRight - upLeft;
+	result.normalize();
+	return result;
+}
+
+Vector Camera::getUpDir() const
+{
+	Vector result = upLeft - downLeft;
+	result.normalize();
+	return result;
+}
@@ -40,6 +40,15 @@ public:
 	
 	/// generates a screen ray through a pixel (x, y - screen coordinates, not necessarily integer).
 	Ray getScreenRay(double x, double y);
+	
+	/// the inverse of getScreenRay(): finds the screen coordinates (x, y), where the point p is seen.
+	/// Returns false if p is behind the camera.
+	bool project(const Vector& p, double& x, double& y) const;
+	
+	// the camera's axes in world space (unit vectors), valid after beginRender():
+	Vector getFrontDir() const; //!< the view direction (through the center of the screen)
+	Vector getRightDir() const; //!< towards the right edge of the screen
+	Vector getUpDir() const; //!< towards the top edge of the screen
 };
 
 
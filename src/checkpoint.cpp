@@ -0,0 +1,281 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2012 by Veselin Georgiev, Slavomir Kaslev et al    *
+ *   admin@raytracing-bg.net                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "checkpoint.h"
+#include "context.h"
+#include "threads.h"
+#include "sdl.h"
+using std::vector;
+
+extern void renderTile(int x0, int y0, int x1, int y1);
+
+const int CHECKPOINT_TILE_SIZE = 32;
+const char CHECKPOINT_MAGIC[8] = { 'R', 'T', 'C', 'K', 'P', 'T', '0', '1' };
+const int FINGERPRINT_SIZE = 12;
+
+/// the file header; the completion mask and the colors follow (as floats)
+struct CheckpointHeader {
+	char magic[8];
+	int kind, width, height, tileSize;
+	int count; //!< the completed tiles, or the passes
+	double fingerprint[FINGERPRINT_SIZE];
+};
+
+/// describes the current context's frame: any change of these makes a checkpoint useless
+static void getFingerprint(double* f)
+{
+	const RenderContext& rc = *currentContext;
+	const Camera& c = rc.camera;
+	double values[FINGERPRINT_SIZE] = {
+		c.pos.x, c.pos.y, c.pos.z, c.yaw, c.pitch, c.roll, c.fov,
+		rc.lightPos.x, rc.lightPos.y, rc.lightPos.z,
+		(double) rc.scene.nodes.size(), (double) rc.sampler
+	};
+	memcpy(f, values, sizeof(values));
+}
+
+static void appendBytes(vector<unsigned char>& out, const void* data, size_t size)
+{
+	const unsigned char* p = (const unsigned char*) data;
+	out.insert(out.end(), p, p + size);
+}
+
+static void appendColors(vector<unsigned char>& out, const Color* colors, int count)
+{
+	for (int i = 0; i < count; i++) {
+		float rgb[3] = { colors[i].r, colors[i].g, colors[i].b };
+		appendBytes(out, rgb, sizeof(rgb));
+	}
+}
+
+static bool readColors(FILE* fp, Color* colors, int count)
+{
+	for (int i = 0; i < count; i++) {
+		float rgb[3];
+		if (fread(rgb, sizeof(rgb), 1, fp) != 1) return false;
+		colors[i] = Color(rgb[0], rgb[1], rgb[2]);
+	}
+	return true;
+}
+
+Checkpoint::Checkpoint(const char* filename, double interval, CheckpointKind kind)
+{
+	this->filename = filename;
+	this->interval = (Uint32) (interval * 1000);
+	this->kind = kind;
+	width = frameWidth();
+	height = frameHeight();
+	int tilesX = (width + CHECKPOINT_TILE_SIZE - 1) / CHECKPOINT_TILE_SIZE;
+	int tilesY = (height + CHECKPOINT_TILE_SIZE - 1) / CHECKPOINT_TILE_SIZE;
+	if (kind == CHECKPOINT_TILES) tileDone.assign(tilesX * tilesY, 0);
+	tilesDone = 0;
+	passes = 0;
+	current = NULL;
+	mutex = SDL_CreateMutex();
+	lastSave = SDL_GetTicks();
+	writing = false;
+	writer = NULL;
+}
+
+Checkpoint::~Checkpoint()
+{
+	if (writer) SDL_WaitThread(writer, NULL);
+	SDL_DestroyMutex(mutex);
+}
+
+void Checkpoint::getTile(int i, int& x0, int& y0, int& x1, int& y1) const
+{
+	int tilesX = (width + CHECKPOINT_TILE_SIZE - 1) / CHECKPOINT_TILE_SIZE;
+	x0 = (i % tilesX) * CHECKPOINT_TILE_SIZE;
+	y0 = (i / tilesX) * CHECKPOINT_TILE_SIZE;
+	x1 = x0 + CHECKPOINT_TILE_SIZE < width ? x0 + CHECKPOINT_TILE_SIZE : width;
+	y1 = y0 + CHECKPOINT_TILE_SIZE < height ? y0 + CHECKPOINT_TILE_SIZE : height;
+}
+
+/// the file contents for the current state: the header, then either the completion mask and the
+/// colors of the completed tiles (row by row within each tile), or the accumulation buffer
+void Checkpoint::serialize(vector<unsigned char>& out) const
+{
+	CheckpointHeader hdr;
+	memcpy(hdr.magic, CHECKPOINT_MAGIC, sizeof(hdr.magic));
+	hdr.kind = kind;
+	hdr.width = width;
+	hdr.height = height;
+	hdr.tileSize = CHECKPOINT_TILE_SIZE;
+	hdr.count = kind == CHECKPOINT_TILES ? tilesDone : passes;
+	getFingerprint(hdr.fingerprint);
+	out.clear();
+	appendBytes(out, &hdr, sizeof(hdr));
+	if (kind == CHECKPOINT_TILES) {
+		appendBytes(out, &tileDone[0], tileDone.size());
+		for (int i = 0; i < (int) tileDone.size(); i++) {
+			if (!tileDone[i]) continue;
+			int x0, y0, x1, y1;
+			getTile(i, x0, y0, x1, y1);
+			for (int y = y0; y < y1; y++)
+				appendColors(out, &currentContext->vfb[y][x0], x1 - x0);
+		}
+	} else {
+		const vector<Color>& buffer = current ? *current : accum;
+		if (!buffer.empty()) appendColors(out, &buffer[0], width * height);
+	}
+}
+
+bool Checkpoint::writeFile(const char* filename, const vector<unsigned char>& contents)
+{
+	char temp[1024];
+	snprintf(temp, sizeof(temp), "%s.tmp", filename);
+	FILE* fp = fopen(temp, "wb");
+	if (!fp) return false;
+	bool ok = fwrite(&contents[0], 1, contents.size(), fp) == contents.size();
+	if (fclose(fp)) ok = false;
+	if (!ok) {
+		remove(temp);
+		return false;
+	}
+#ifdef _WIN32
+	remove(filename); // rename() doesn't replace files there
+#endif
+	return rename(temp, filename) == 0;
+}
+
+int Checkpoint::writerThread(void* data)
+{
+	Checkpoint* cp = (Checkpoint*) data;
+	bool ok = writeFile(cp->filename, cp->pending);
+	if (!ok) printf("Cannot save the checkpoint `%s'\n", cp->filename);
+	SDL_mutexP(cp->mutex);
+	cp->writing = false;
+	SDL_mutexV(cp->mutex);
+	return ok ? 0 : 1;
+}
+
+void Checkpoint::startWriter(void)
+{
+	if (writer) SDL_WaitThread(writer, NULL); // already done, since !writing
+	serialize(pending);
+	writing = true;
+	lastSave = SDL_GetTicks();
+	writer = SDL_CreateThread(writerThread, this);
+}
+
+bool Checkpoint::resume(void)
+{
+	FILE* fp = fopen(filename, "rb");
+	if (!fp) return false;
+	CheckpointHeader hdr, expected;
+	getFingerprint(expected.fingerprint);
+	bool ok = fread(&hdr, sizeof(hdr), 1, fp) == 1 && !memcmp(hdr.magic, CHECKPOINT_MAGIC, sizeof(hdr.magic));
+	if (!ok || hdr.kind != kind || hdr.width != width || hdr.height != height || hdr.tileSize != CHECKPOINT_TILE_SIZE
+	    || memcmp(hdr.fingerprint, expected.fingerprint, sizeof(expected.fingerprint))) {
+		printf("The checkpoint `%s' is of a different render; starting over\n", filename);
+		fclose(fp);
+		return false;
+	}
+	if (kind == CHECKPOINT_TILES) {
+		vector<unsigned char> mask(tileDone.size());
+		ok = fread(&mask[0], 1, mask.size(), fp) == mask.size();
+		int count = 0;
+		for (int i = 0; ok && i < (int) mask.size(); i++) {
+			if (!mask[i]) continue;
+			int x0, y0, x1, y1;
+			getTile(i, x0, y0, x1, y1);
+			for (int y = y0; ok && y < y1; y++)
+				ok = readColors(fp, &currentContext->vfb[y][x0], x1 - x0);
+			count++;
+		}
+		if (ok) {
+			tileDone = mask;
+			tilesDone = count;
+			printf("Resuming from `%s': %d of %d tiles done\n", filename, count, (int) mask.size());
+		}
+	} else {
+		accum.resize(width * height);
+		ok = readColors(fp, &accum[0], width * height);
+		if (ok) {
+			passes = hdr.count;
+			printf("Resuming from `%s': %d passes done\n", filename, passes);
+		} else accum.clear();
+	}
+	fclose(fp);
+	if (!ok) printf("The checkpoint `%s' is truncated; starting over\n", filename);
+	return ok;
+}
+
+bool Checkpoint::save(void)
+{
+	if (writer) {
+		SDL_WaitThread(writer, NULL);
+		writer = NULL;
+	}
+	serialize(pending);
+	lastSave = SDL_GetTicks();
+	if (writeFile(filename, pending)) return true;
+	printf("Cannot save the checkpoint `%s'\n", filename);
+	return false;
+}
+
+void Checkpoint::markTileDone(int i)
+{
+	SDL_mutexP(mutex);
+	tileDone[i] = 1;
+	tilesDone++;
+	if (!writing && SDL_GetTicks() - lastSave >= interval) startWriter();
+	SDL_mutexV(mutex);
+}
+
+void Checkpoint::passDone(const vector<Color>& accum, int passes)
+{
+	SDL_mutexP(mutex);
+	current = &accum;
+	this->passes = passes;
+	if (!writing && SDL_GetTicks() - lastSave >= interval) startWriter();
+	SDL_mutexV(mutex);
+}
+
+/// the tiles, renderCheckpointed() has to render
+struct MissingTiles {
+	Checkpoint* checkpoint;
+	vector<int> tiles;
+};
+
+/// renders and checkpoints the missing tiles [begin..end), as a parallelFor() kernel
+static void kernelMissingTiles(int begin, int end, void* data)
+{
+	MissingTiles& mt = *(MissingTiles*) data;
+	for (int i = begin; i < end; i++) {
+		int x0, y0, x1, y1;
+		mt.checkpoint->getTile(mt.tiles[i], x0, y0, x1, y1);
+		renderTile(x0, y0, x1, y1);
+		mt.checkpoint->markTileDone(mt.tiles[i]);
+	}
+}
+
+int renderCheckpointed(Checkpoint& checkpoint)
+{
+	MissingTiles mt;
+	mt.checkpoint = &checkpoint;
+	for (int i = 0; i < checkpoint.getTileCount(); i++)
+		if (!checkpoint.isTileDone(i)) mt.tiles.push_back(i);
+	parallelFor((int) mt.tiles.size(), 1, kernelMissingTiles, &mt);
+	return (int) mt.tiles.size();
+}
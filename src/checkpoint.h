@@ -0,0 +1,97 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2012 by Veselin Georgiev, Slavomir Kaslev et al    *
+ *   admin@raytracing-bg.net                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#ifndef __CHECKPOINT_H__
+#define __CHECKPOINT_H__
+
+#include <SDL/SDL.h>
+#include <SDL/SDL_thread.h>
+#include <vector>
+#include "color.h"
+
+/// what a checkpoint holds
+enum CheckpointKind {
+	CHECKPOINT_TILES, //!< the completed tiles of the vfb (renderCheckpointed())
+	CHECKPOINT_PASSES //!< the accumulation buffer and the pass count of renderProgressive()
+};
+
+/// A checkpoint of a long render of the current context's frame, kept in a file, so that a killed
+/// render can be resumed without losing the completed work. The file is rewritten every `interval'
+/// seconds (at most) while rendering, by a separate thread: the renderer only copies the completed
+/// work into the writer's buffer, and never waits for the disk. If the writer is still busy when the
+/// next checkpoint is due, it's postponed. The file is written under a temporary name and renamed
+/// over the old one, so a crash while writing leaves the previous checkpoint intact.
+///
+/// The file records the frame size and a fingerprint of the camera, the light, the scene size and
+/// the sampler; resume() only accepts a checkpoint of the same frame.
+class Checkpoint {
+	Checkpoint(const Checkpoint&);
+	Checkpoint& operator = (const Checkpoint&);
+	
+	const char* filename;
+	Uint32 interval; //!< in milliseconds
+	CheckpointKind kind;
+	int width, height;
+	std::vector<unsigned char> tileDone; //!< per tile, for CHECKPOINT_TILES
+	int tilesDone;
+	int passes; //!< for CHECKPOINT_PASSES
+	std::vector<Color> accum; //!< for CHECKPOINT_PASSES: the loaded accumulation buffer
+	const std::vector<Color>* current; //!< for CHECKPOINT_PASSES: the renderer's one, after passDone()
+	
+	SDL_mutex* mutex; //!< guards all of the above, and `writing'
+	Uint32 lastSave;
+	bool writing; //!< the writer thread is busy
+	SDL_Thread* writer;
+	std::vector<unsigned char> pending; //!< the file contents, handed to the writer
+	
+	void serialize(std::vector<unsigned char>& out) const;
+	void startWriter(void); //!< with the mutex locked
+	static int writerThread(void* data);
+	static bool writeFile(const char* filename, const std::vector<unsigned char>& contents);
+public:
+	/// a checkpoint of the current context's frame, saved to filename
+	Checkpoint(const char* filename, double interval, CheckpointKind kind);
+	~Checkpoint(); //!< waits for the writer to finish
+	
+	/// loads the checkpoint file, if it exists and matches the frame. For CHECKPOINT_TILES, the
+	/// completed tiles are written to the vfb. Returns true if anything was loaded.
+	bool resume(void);
+	/// writes the current state (waiting for the writer first); returns false on errors
+	bool save(void);
+	
+	// CHECKPOINT_TILES:
+	int getTileCount(void) const { return (int) tileDone.size(); }
+	void getTile(int i, int& x0, int& y0, int& x1, int& y1) const;
+	bool isTileDone(int i) const { return tileDone[i] != 0; }
+	/// marks the tile as complete (in the vfb); saves a checkpoint if it's due. Thread-safe.
+	void markTileDone(int i);
+	
+	// CHECKPOINT_PASSES:
+	int getPasses(void) const { return passes; }
+	const std::vector<Color>& getAccumulation(void) const { return accum; }
+	/// records the state after a pass; saves a checkpoint if it's due
+	void passDone(const std::vector<Color>& accum, int passes);
+};
+
+/// like renderScene(), but tile by tile, over the thread pool, skipping the tiles that the checkpoint
+/// has as complete, and checkpointing the completed ones. The result is the same as renderScene()'s.
+/// Returns the number of tiles rendered.
+int renderCheckpointed(Checkpoint& checkpoint);
+
+#endif // __CHECKPOINT_H__
@@ -55,41 +55,6 @@ struct Color {
 		return (ib << blueShift) | (ig << greenShift) | (ir << redShift);
 	}
 
-	unsigned toRGB32(Color vfb[VFB_MAX_SIZE][VFB_MAX_SIZE], unsigned x, unsigned y)
-	{
-
-		//calculate converted to 8 bit colours
-		unsigned ir = convertTo8bit(r);
-		unsigned ig = convertTo8bit(g);
-		unsigned ib = convertTo8bit(b);
-
-		//take the errors for all three channels
-		double quant_error_red = 255*r -  ir;
-		double quant_error_green = 255*g - ig;
-		double quant_error_blue = 255*b -  ib;
-
-		//diffuse the error accorting to Floyd-Steinberg dithering
-		vfb[y][x+1].r+=((7.0f/16)*quant_error_red)/255;
-		vfb[y][x+1].g+=((7.0f/16)*quant_error_green)/255;
-		vfb[y][x+1].b+=((7.0f/16)*quant_error_blue)/255;
-
-		vfb[y+1][x+1].r+=((1.0f/16)*quant_error_red)/255;
-		vfb[y+1][x+1].g+=((1.0f/16)*quant_error_green)/255;
-		vfb[y+1][x+1].b+=((1.0f/16)*quant_error_blue)/255;
-
-		vfb[y+1][x-1].r+=((3.0f/16)*quant_error_red)/255;
-		vfb[y+1][x-1].g+=((3.0f/16)*quant_error_green)/255;
-		vfb[y+1][x-1].b+=((3.0f/16)*quant_error_blue)/255;
-
-		vfb[y+1][x].r+=((5.0/16)*quant_error_red)/255;
-		vfb[y+1][x].g+=((5.0/16)*quant_error_green)/255;
-		vfb[y+1][x].b+=((5.0/16)*quant_error_blue)/255;
-
-		//return standart 32 bit color
-		return (ib << 0) | (ig << 8) | (ir << 16);
-	}
-
-
 	/// make black
 	void makeZero(void)
 	{
@@ -28,6 +28,12 @@
 #define RESX 640
 #define RESY 480
 
+// number of the built-in scenes (see generateScene()), selected with --scene
+#define SCENE_COUNT 2
+
+// number of samples per pixel for anti-aliasing
+#define AA_SAMPLES 5
+
 // pi:
 #define PI 3.141592653589793238
 
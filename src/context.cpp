@@ -0,0 +1,120 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2012 by Veselin Georgiev, Slavomir Kaslev et al    *
+ *   admin@raytracing-bg.net                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <SDL/SDL.h>
+#include <SDL/SDL_thread.h>
+#include "context.h"
+#include "threads.h"
+
+extern void renderTile(int x0, int y0, int x1, int y1);
+
+THREAD_LOCAL RenderContext* currentContext = NULL;
+
+static SDL_mutex* generationMutex = SDL_CreateMutex(); //!< guards lastGeneration
+static int lastGeneration = 0;
+
+static int newGeneration(void)
+{
+	SDL_mutexP(generationMutex);
+	int result = ++lastGeneration;
+	SDL_mutexV(generationMutex);
+	return result;
+}
+
+RenderContext::RenderContext(int width, int height)
+{
+	sceneGeneration = newGeneration();
+	camera.pos.makeZero();
+	camera.yaw = camera.pitch = camera.roll = 0;
+	camera.fov = 90;
+	lightPos.makeZero();
+	lightIntensity = Color(0, 0, 0);
+	ambient = Color(0.1f, 0.1f, 0.1f);
+	vfb = NULL;
+	auxBuffers = NULL;
+	sampler = SAMPLER_SOBOL;
+	shadowMapSize = 0;
+	resize(width, height);
+}
+
+RenderContext::~RenderContext()
+{
+	shadowMap.clear();
+	bvh.clear();
+	scene.clear();
+	delete [] vfb;
+}
+
+void RenderContext::resize(int _width, int _height)
+{
+	if (!vfb || _height != height) {
+		delete [] vfb;
+		vfb = new Color[_height][VFB_MAX_SIZE];
+	}
+	width = _width;
+	height = _height;
+	camera.aspect = width / (double) height;
+}
+
+void RenderContext::sceneChanged(void)
+{
+	sceneGeneration = newGeneration();
+}
+
+void RenderContext::prepareFrame(void)
+{
+	if (shadowMapSize > 0) shadowMap.build(bvh, lightPos, shadowMapSize);
+	else shadowMap.clear();
+}
+
+const int CONTEXT_TILE_SIZE = 32;
+
+/// the region of the frame, a kernelTiles() call covers
+struct TileRegion {
+	int x0, y0, x1, y1;
+};
+
+/// renderTile() over the tiles of a region of the current context's frame, as a parallelFor() kernel
+static void kernelTiles(int begin, int end, void* data)
+{
+	const TileRegion& r = *(TileRegion*) data;
+	int tilesX = (r.x1 - r.x0 + CONTEXT_TILE_SIZE - 1) / CONTEXT_TILE_SIZE;
+	for (int i = begin; i < end; i++) {
+		int x0 = r.x0 + (i % tilesX) * CONTEXT_TILE_SIZE, y0 = r.y0 + (i / tilesX) * CONTEXT_TILE_SIZE;
+		int x1 = x0 + CONTEXT_TILE_SIZE < r.x1 ? x0 + CONTEXT_TILE_SIZE : r.x1;
+		int y1 = y0 + CONTEXT_TILE_SIZE < r.y1 ? y0 + CONTEXT_TILE_SIZE : r.y1;
+		renderTile(x0, y0, x1, y1);
+	}
+}
+
+void renderContextRegion(RenderContext& rc, int x0, int y0, int x1, int y1)
+{
+	if (x1 <= x0 || y1 <= y0) return;
+	ContextScope scope(rc);
+	TileRegion region = { x0, y0, x1, y1 };
+	int tilesX = (x1 - x0 + CONTEXT_TILE_SIZE - 1) / CONTEXT_TILE_SIZE;
+	int tilesY = (y1 - y0 + CONTEXT_TILE_SIZE - 1) / CONTEXT_TILE_SIZE;
+	parallelFor(tilesX * tilesY, 1, kernelTiles, &region);
+}
+
+void renderContext(RenderContext& rc)
+{
+	renderContextRegion(rc, 0, 0, rc.width, rc.height);
+}
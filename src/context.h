@@ -0,0 +1,89 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2012 by Veselin Georgiev, Slavomir Kaslev et al    *
+ *   admin@raytracing-bg.net                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#ifndef __CONTEXT_H__
+#define __CONTEXT_H__
+
+#include "util.h"
+#include "color.h"
+#include "vector.h"
+#include "camera.h"
+#include "scene.h"
+#include "bvh.h"
+#include "output.h"
+#include "sampler.h"
+#include "shadowmap.h"
+
+struct AuxBuffers;
+
+/// Everything a render works on: the scene and its BVH, the camera, the light, the frame
+/// buffer and the render settings. The renderers and the shaders use the calling thread's
+/// current context (currentContext), which parallelFor() passes on to the pool threads that
+/// run its chunks. So independent contexts may be rendered at the same time, by different
+/// threads, while sharing the thread pool.
+class RenderContext {
+	RenderContext(const RenderContext&);
+	RenderContext& operator = (const RenderContext&);
+public:
+	Scene scene;
+	BVH bvh; //!< acceleration structure over scene.nodes
+	int sceneGeneration; //!< unique among all contexts; changes whenever scene.nodes does
+	Camera camera;
+	Vector lightPos;
+	Color lightIntensity;
+	Color ambient;
+	
+	int width, height; //!< the frame size
+	Color (*vfb)[VFB_MAX_SIZE]; //!< the virtual framebuffer: `height' rows of VFB_MAX_SIZE colors
+	AuxBuffers* auxBuffers; //!< if set, the primary hits are recorded there (see denoise.h)
+	PostProcess postProcess; //!< the settings of the output stage (quantizeFrame())
+	SamplerType sampler; //!< the sub-pixel sample pattern (change it with setSampler())
+	int shadowMapSize; //!< if nonzero, prepareFrame() builds a shadow map of that resolution
+	ShadowMap shadowMap; //!< answers the shadow queries towards lightPos, while it's built for it
+	
+	RenderContext(int width = RESX, int height = RESY);
+	~RenderContext();
+	
+	void resize(int width, int height); //!< changes the frame size; the vfb contents are lost
+	void sceneChanged(void); //!< must be called after scene.nodes changes (drops stale per-thread caches)
+	/// builds the per-frame data (the shadow map, if enabled). Call it once the scene and the
+	/// light are set up for the frame, before rendering it.
+	void prepareFrame(void);
+};
+
+/// the context of the calling thread
+extern THREAD_LOCAL RenderContext* currentContext;
+
+/// makes a context current for the calling thread, until the end of the scope
+class ContextScope {
+	RenderContext* saved;
+public:
+	ContextScope(RenderContext& rc) { saved = currentContext; currentContext = &rc; }
+	~ContextScope() { currentContext = saved; }
+};
+
+/// renders the context's scene into its vfb with the ray tracer (including the adaptive AA),
+/// spread over the thread pool. Any thread may call it, for any context; calls for different
+/// contexts may run at the same time.
+void renderContext(RenderContext& rc);
+
+/// like renderContext(), for the rectangle [x0..x1) x [y0..y1) of the frame only
+void renderContextRegion(RenderContext& rc, int x0, int y0, int x1, int y1);
+
+#endif // __CONTEXT_H__
@@ -0,0 +1,188 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2012 by Veselin Georgiev, Slavomir Kaslev et al    *
+ *   admin@raytracing-bg.net                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <stdio.h>
+#include <algorithm>
+#include <map>
+#include "denoise.h"
+#include "geometry.h"
+#include "shading.h"
+#include "bitmap.h"
+#include "threads.h"
+#include "sdl.h"
+#include "scene.h"
+#include "context.h"
+using std::vector;
+using std::swap;
+
+const float SIGMA_COLOR = 0.5f; //!< color tolerance at the first iteration (halved at each next one)
+const int NORMAL_SHARPNESS = 6; //!< the normals' dot product is raised to the 2^NORMAL_SHARPNESS-th power
+const float SIGMA_DEPTH = 0.02f; //!< depth tolerance, relative to the center pixel's depth and the step
+const float MIN_ALBEDO = 0.01f; //!< channels with lower albedo aren't demodulated
+
+void AuxBuffers::resize(int w, int h)
+{
+	width = w;
+	height = h;
+	depth.assign(w * h, (float) INF);
+	normal.assign(w * h, Vector(0, 0, 0));
+	albedo.assign(w * h, Color(0, 0, 0));
+	node.assign(w * h, (const Node*) NULL);
+}
+
+void AuxBuffers::record(int x, int y, const Ray& ray, const Node* hitNode, const IntersectionInfo& info)
+{
+	int i = y * width + x;
+	node[i] = hitNode;
+	if (!hitNode) {
+		depth[i] = (float) INF;
+		normal[i].makeZero();
+		albedo[i] = Color(0, 0, 0);
+		return;
+	}
+	depth[i] = (float) info.distance;
+	normal[i] = faceforward(info.norm, ray.dir);
+	albedo[i] = hitNode->shader->getAlbedo(info);
+}
+
+bool AuxBuffers::save(const char* prefix) const
+{
+	const Scene& scene = currentContext->scene;
+	std::map<const Node*, int> nodeIndex; //!< the index of each node in scene.nodes
+	for (int j = 0; j < (int) scene.nodes.size(); j++) nodeIndex[scene.nodes[j]] = j;
+	float maxDepth = 0;
+	for (int i = 0; i < width * height; i++)
+		if (node[i] && depth[i] > maxDepth) maxDepth = depth[i];
+	Bitmap bmp[4];
+	const char* suffixes[4] = { "depth", "normal", "albedo", "node" };
+	for (int k = 0; k < 4; k++) bmp[k].generateEmptyImage(width, height);
+	for (int y = 0; y < height; y++)
+		for (int x = 0; x < width; x++) {
+			int i = y * width + x;
+			float d = node[i] ? 1 - depth[i] / maxDepth : 0; // near is bright
+			bmp[0].setPixel(x, y, Color(d, d, d));
+			const Vector& n = normal[i];
+			bmp[1].setPixel(x, y, Color(float(n.x * 0.5 + 0.5), float(n.y * 0.5 + 0.5), float(n.z * 0.5 + 0.5)));
+			bmp[2].setPixel(x, y, albedo[i]);
+			std::map<const Node*, int>::const_iterator it = nodeIndex.find(node[i]);
+			int id = it == nodeIndex.end() ? -1 : it->second;
+			unsigned h = (unsigned) (id + 1) * 2654435761u;
+			bmp[3].setPixel(x, y, id < 0 ? Color(0, 0, 0) : Color((h >> 24) / 255.0f, ((h >> 16) & 0xff) / 255.0f, ((h >> 8) & 0xff) / 255.0f));
+		}
+	for (int k = 0; k < 4; k++) {
+		char filename[1024];
+		snprintf(filename, sizeof(filename), "%s_%s.bmp", prefix, suffixes[k]);
+		if (!bmp[k].saveBMP(filename)) {
+			printf("Cannot save `%s'\n", filename);
+			return false;
+		}
+	}
+	return true;
+}
+
+/// the state of an à-trous iteration
+struct FilterPass {
+	const AuxBuffers* aux;
+	Color* in;
+	Color* out;
+	int step;
+	float sigmaColor;
+};
+
+static const float atrousKernel[5] = { 1 / 16.0f, 1 / 4.0f, 3 / 8.0f, 1 / 4.0f, 1 / 16.0f };
+
+static void kernelFilterRows(int begin, int end, void* data)
+{
+	const FilterPass* fp = (const FilterPass*) data;
+	const AuxBuffers& aux = *fp->aux;
+	int W = aux.width, H = aux.height;
+	float invSigmaColor2 = 1.0f / (fp->sigmaColor * fp->sigmaColor);
+	for (int y = begin; y < end; y++)
+		for (int x = 0; x < W; x++) {
+			int p = y * W + x;
+			const Node* node = aux.node[p];
+			if (!node) { // background: nothing to filter
+				fp->out[p] = fp->in[p];
+				continue;
+			}
+			Color c = fp->in[p];
+			float depthTolerance = SIGMA_DEPTH * aux.depth[p] * fp->step;
+			Color sum(0, 0, 0);
+			float weights = 0;
+			for (int dy = -2; dy <= 2; dy++) {
+				int qy = y + dy * fp->step;
+				if (qy < 0 || qy >= H) continue;
+				for (int dx = -2; dx <= 2; dx++) {
+					int qx = x + dx * fp->step;
+					if (qx < 0 || qx >= W) continue;
+					int q = qy * W + qx;
+					if (aux.node[q] != node) continue;
+					Color cq = fp->in[q];
+					Color diff = c - cq;
+					float w = atrousKernel[dy + 2] * atrousKernel[dx + 2];
+					w *= expf(-(diff.r * diff.r + diff.g * diff.g + diff.b * diff.b) * invSigmaColor2);
+					float cosAngle = (float) dot(aux.normal[p], aux.normal[q]);
+					if (cosAngle <= 0) continue;
+					for (int k = 0; k < NORMAL_SHARPNESS; k++) cosAngle *= cosAngle;
+					w *= cosAngle;
+					w *= expf(-fabs(aux.depth[p] - aux.depth[q]) / depthTolerance);
+					sum += cq * w;
+					weights += w;
+				}
+			}
+			fp->out[p] = weights > 0 ? sum / weights : c;
+		}
+}
+
+/// the factor, by which a color is divided before filtering (per channel)
+static inline float demodulation(float albedo)
+{
+	return albedo > MIN_ALBEDO ? albedo : 1.0f;
+}
+
+void denoiseVFB(const AuxBuffers& aux, int iterations)
+{
+	Color (*vfb)[VFB_MAX_SIZE] = currentContext->vfb;
+	int W = aux.width, H = aux.height;
+	vector<Color> a(W * H), b(W * H);
+	for (int y = 0; y < H; y++)
+		for (int x = 0; x < W; x++) {
+			const Color& alb = aux.albedo[y * W + x];
+			const Color& c = vfb[y][x];
+			a[y * W + x] = Color(c.r / demodulation(alb.r), c.g / demodulation(alb.g), c.b / demodulation(alb.b));
+		}
+	FilterPass fp;
+	fp.aux = &aux;
+	fp.sigmaColor = SIGMA_COLOR;
+	fp.in = &a[0];
+	fp.out = &b[0];
+	for (int i = 0; i < iterations; i++) {
+		fp.step = 1 << i;
+		parallelFor(H, 4, kernelFilterRows, &fp);
+		swap(fp.in, fp.out); // the output is the next iteration's input
+		fp.sigmaColor *= 0.5f;
+	}
+	for (int y = 0; y < H; y++)
+		for (int x = 0; x < W; x++) {
+			const Color& alb = aux.albedo[y * W + x];
+			const Color& c = fp.in[y * W + x];
+			vfb[y][x] = Color(c.r * demodulation(alb.r), c.g * demodulation(alb.g), c.b * demodulation(alb.b));
+		}
+}
@@ -0,0 +1,55 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2012 by Veselin Georgiev, Slavomir Kaslev et al    *
+ *   admin@raytracing-bg.net                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#ifndef __DENOISE_H__
+#define __DENOISE_H__
+
+#include <vector>
+#include "color.h"
+#include "vector.h"
+
+class Node;
+struct IntersectionInfo;
+
+/// Per-pixel data about the primary hits (the surfaces, seen through the pixel centers),
+/// which guides the denoiser. Filled in by the renderers during the primary pass, if
+/// the current context (see context.h) has auxBuffers set.
+struct AuxBuffers {
+	int width, height;
+	std::vector<float> depth; //!< distance to the hit (INF for misses)
+	std::vector<Vector> normal; //!< facing the camera (zero for misses)
+	std::vector<Color> albedo; //!< Shader::getAlbedo() at the hit (black for misses)
+	std::vector<const Node*> node; //!< the node, which was hit (NULL for misses)
+	
+	void resize(int w, int h);
+	/// stores the primary hit of pixel (x, y); node is NULL for a miss
+	void record(int x, int y, const Ray& ray, const Node* hitNode, const IntersectionInfo& info);
+	/// saves the buffers as <prefix>_depth.bmp, <prefix>_normal.bmp, <prefix>_albedo.bmp and <prefix>_node.bmp
+	bool save(const char* prefix) const;
+};
+
+
+/// An edge-avoiding à-trous wavelet filter over the vfb. Each iteration is a 5x5 B3-spline
+/// blur with holes (step 1, 2, 4, ...), where a neighbour's weight also falls off with
+/// its difference in color, depth and normal from the center pixel, and is zero if it belongs
+/// to another node. The colors are divided by the albedo before filtering and multiplied
+/// back afterwards, so textures stay sharp. The rows are split among the rendering threads.
+void denoiseVFB(const AuxBuffers& aux, int iterations = 5);
+
+#endif // __DENOISE_H__
@@ -0,0 +1,412 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2012 by Veselin Georgiev, Slavomir Kaslev et al    *
+ *   admin@raytracing-bg.net                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <SDL/SDL.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "distributed.h"
+#include "color.h"
+#include "sdl.h"
+#include "sampler.h"
+#include "net.h"
+#include "context.h"
+using std::vector;
+
+#ifdef _WIN32
+
+bool renderDistributed(const char* address, int spawnWorkers, const char* self, int sceneId)
+{
+	printf("Distributed rendering is not supported on this platform\n");
+	return false;
+}
+
+bool runWorker(const char* address, int sceneId)
+{
+	printf("Distributed rendering is not supported on this platform\n");
+	return false;
+}
+
+#else
+
+#include <errno.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <sys/wait.h>
+#include <arpa/inet.h>
+
+extern void renderTile(int x0, int y0, int x1, int y1);
+extern bool generateScene(int sceneId);
+extern void freeScene(void);
+
+/*
+ * The protocol. Every message is a sequence of 32-bit words in network byte order,
+ * starting with the message type:
+ *
+ * coordinator -> worker:
+ *    MSG_HELLO   magic, frameWidth, frameHeight, x, y, z, yaw, pitch, roll, fov
+ *                (the camera, as float bits; the workers render with it instead of the scene's)
+ *    MSG_TILE    tileId, x0, y0, x1, y1
+ *    MSG_QUIT
+ * worker -> coordinator:
+ *    MSG_RESULT  tileId, x0, y0, x1, y1, followed by (x1-x0)*(y1-y0) RGB triples of floats
+ */
+enum {
+	MSG_HELLO = 1,
+	MSG_TILE,
+	MSG_RESULT,
+	MSG_QUIT,
+};
+
+const unsigned PROTOCOL_MAGIC = 0x52545232; // "RTR2"
+const int HELLO_WORDS = 11;
+const int TILE_SIZE = 32;
+const int MAX_OUTSTANDING = 2; //!< tiles in flight per worker, so workers don't idle while a result is in transit
+const Uint32 MIN_REISSUE_TIME = 250; //!< never re-issue a tile before it's been out for that long (ms)
+const Uint32 STALL_TIMEOUT = 10000; //!< drop a worker that sent part of a message, and nothing more for that long (ms)
+const Uint32 NO_WORKERS_TIMEOUT = 60000; //!< give up, if no worker is connected for that long (ms)
+const int RESULT_HEADER_SIZE = 6 * sizeof(unsigned);
+
+/// a tile of the frame, as tracked by the coordinator
+struct Tile {
+	int x0, y0, x1, y1;
+	bool done;
+	int assignments; //!< how many workers are currently rendering that tile
+	Uint32 issuedAt; //!< when the tile was last handed out (SDL_GetTicks())
+};
+
+/// a connected worker, as tracked by the coordinator
+struct Worker {
+	int fd;
+	vector<int> outstanding; //!< the tiles sent to that worker, for which we await a result
+	int tilesDone;
+	vector<unsigned char> inbox; //!< received bytes, which don't make a complete message yet
+	Uint32 lastReceived; //!< when the last bytes arrived (SDL_GetTicks())
+};
+
+static void dropWorker(vector<Worker>& workers, int index, vector<Tile>& tiles)
+{
+	Worker& w = workers[index];
+	for (int i = 0; i < (int) w.outstanding.size(); i++)
+		tiles[w.outstanding[i]].assignments--; // these go back to the queue
+	close(w.fd);
+	workers.erase(workers.begin() + index);
+}
+
+/// picks the next tile for a worker: a tile, that hasn't been handed out yet, or (when all are out)
+/// the longest outstanding one, provided it's taking much longer than an average tile since it
+/// was last handed out (so a tile may be re-issued again, if the second worker is slow too).
+/// Returns -1 if there's nothing to do.
+static int pickTile(vector<Tile>& tiles, const Worker& w, Uint32 avgTileTime)
+{
+	for (int i = 0; i < (int) tiles.size(); i++)
+		if (!tiles[i].done && tiles[i].assignments == 0) return i;
+	Uint32 now = SDL_GetTicks();
+	Uint32 reissueAfter = 3 * avgTileTime;
+	if (reissueAfter < MIN_REISSUE_TIME) reissueAfter = MIN_REISSUE_TIME;
+	int best = -1;
+	for (int i = 0; i < (int) tiles.size(); i++) {
+		const Tile& t = tiles[i];
+		if (t.done || now - t.issuedAt < reissueAfter) continue;
+		bool mine = false;
+		for (int j = 0; j < (int) w.outstanding.size(); j++)
+			if (w.outstanding[j] == i) mine = true;
+		if (mine) continue;
+		if (best == -1 || t.issuedAt < tiles[best].issuedAt) best = i;
+	}
+	return best;
+}
+
+/// handles a complete result message at the start of w.inbox; returns false if it's bad.
+/// Sets `completed' to the tile, if the message completes it (-1 for a re-issued one, already done).
+static bool handleResult(Worker& w, vector<Tile>& tiles, int& completed)
+{
+	Color (*vfb)[VFB_MAX_SIZE] = currentContext->vfb;
+	const vector<unsigned char>& in = w.inbox;
+	unsigned id = wordAt(in, 4);
+	completed = -1;
+	if (wordAt(in, 0) != MSG_RESULT || id >= tiles.size()) return false;
+	Tile& t = tiles[id];
+	if ((int) wordAt(in, 8) != t.x0 || (int) wordAt(in, 12) != t.y0 || (int) wordAt(in, 16) != t.x1 || (int) wordAt(in, 20) != t.y1)
+		return false;
+	for (int j = 0; j < (int) w.outstanding.size(); j++)
+		if (w.outstanding[j] == (int) id) {
+			w.outstanding.erase(w.outstanding.begin() + j);
+			t.assignments--;
+			break;
+		}
+	w.tilesDone++;
+	if (t.done) return true; // a re-issued tile, which someone else completed first
+	int k = RESULT_HEADER_SIZE;
+	for (int y = t.y0; y < t.y1; y++)
+		for (int x = t.x0; x < t.x1; x++, k += 12)
+			vfb[y][x] = Color(bitsFloat(wordAt(in, k)), bitsFloat(wordAt(in, k + 4)), bitsFloat(wordAt(in, k + 8)));
+	t.done = true;
+	completed = id;
+	return true;
+}
+
+/// the size of the result message at the start of the inbox (0 if even its header isn't complete;
+/// -1 if it's bad)
+static int resultSize(const vector<unsigned char>& inbox, const vector<Tile>& tiles)
+{
+	if ((int) inbox.size() < RESULT_HEADER_SIZE) return 0;
+	unsigned id = wordAt(inbox, 4);
+	if (wordAt(inbox, 0) != MSG_RESULT || id >= tiles.size()) return -1;
+	const Tile& t = tiles[id];
+	return RESULT_HEADER_SIZE + (t.x1 - t.x0) * (t.y1 - t.y0) * 3 * sizeof(float);
+}
+
+static void spawnLocalWorkers(int count, const char* self, const char* address, int sceneId)
+{
+	char scene[16];
+	sprintf(scene, "%d", sceneId);
+	for (int i = 0; i < count; i++) {
+		pid_t pid = fork();
+		if (pid == 0) {
+			// the workers must render the same scene, and place their AA samples the same way:
+			execl(self, self, "--worker", address, "--scene", scene, "--sampler", samplerName(), (char*) NULL);
+			execlp(self, self, "--worker", address, "--scene", scene, "--sampler", samplerName(), (char*) NULL);
+			printf("Cannot start worker `%s'\n", self);
+			_exit(1);
+		}
+		if (pid < 0) printf("Cannot fork a local worker\n");
+	}
+}
+
+bool renderDistributed(const char* address, int spawnWorkers, const char* self, int sceneId)
+{
+	signal(SIGPIPE, SIG_IGN);
+	int family;
+	int listenFd = listenOn(address, family);
+	if (listenFd < 0) return false;
+	
+	// split the frame in tiles:
+	vector<Tile> tiles;
+	for (int y = 0; y < frameHeight(); y += TILE_SIZE)
+		for (int x = 0; x < frameWidth(); x += TILE_SIZE) {
+			Tile t;
+			t.x0 = x;
+			t.y0 = y;
+			t.x1 = x + TILE_SIZE < frameWidth() ? x + TILE_SIZE : frameWidth();
+			t.y1 = y + TILE_SIZE < frameHeight() ? y + TILE_SIZE : frameHeight();
+			t.done = false;
+			t.assignments = 0;
+			t.issuedAt = 0;
+			tiles.push_back(t);
+		}
+	
+	printf("Waiting for workers on %s...\n", address);
+	spawnLocalWorkers(spawnWorkers, self, address, sceneId);
+	
+	vector<Worker> workers;
+	int tilesDone = 0, tilesReissued = 0, totalWorkers = 0;
+	Uint32 totalTileTime = 0;
+	Uint32 noWorkersSince = SDL_GetTicks();
+	bool ok = true;
+	while (tilesDone < (int) tiles.size()) {
+		Uint32 now = SDL_GetTicks();
+		if (!workers.empty()) noWorkersSince = now;
+		else if (now - noWorkersSince > NO_WORKERS_TIMEOUT) {
+			printf("No workers for %d seconds; giving up\n", NO_WORKERS_TIMEOUT / 1000);
+			ok = false;
+			break;
+		}
+		
+		// hand out work to anyone with free slots:
+		Uint32 avgTileTime = tilesDone ? totalTileTime / tilesDone : 0;
+		for (int i = 0; i < (int) workers.size(); i++) {
+			Worker& w = workers[i];
+			if ((int) w.outstanding.size() >= MAX_OUTSTANDING) continue;
+			int ti = pickTile(tiles, w, avgTileTime);
+			if (ti == -1) continue;
+			Tile& t = tiles[ti];
+			unsigned msg[6] = { MSG_TILE, (unsigned) ti, (unsigned) t.x0, (unsigned) t.y0, (unsigned) t.x1, (unsigned) t.y1 };
+			if (!sendWords(w.fd, msg, 6)) {
+				dropWorker(workers, i--, tiles);
+				continue;
+			}
+			if (t.assignments > 0) tilesReissued++;
+			t.assignments++;
+			t.issuedAt = SDL_GetTicks();
+			w.outstanding.push_back(ti);
+		}
+		
+		fd_set fds;
+		FD_ZERO(&fds);
+		FD_SET(listenFd, &fds);
+		int maxFd = listenFd;
+		for (int i = 0; i < (int) workers.size(); i++) {
+			FD_SET(workers[i].fd, &fds);
+			if (workers[i].fd > maxFd) maxFd = workers[i].fd;
+		}
+		timeval timeout = { 0, 100000 }; // wake up periodically to check for stragglers
+		int nReady = select(maxFd + 1, &fds, NULL, NULL, &timeout);
+		if (nReady < 0) {
+			if (errno == EINTR) continue;
+			printf("select() failed: %s\n", strerror(errno));
+			ok = false;
+			break;
+		}
+		
+		// new workers:
+		if (FD_ISSET(listenFd, &fds)) {
+			int fd = accept(listenFd, NULL, NULL);
+			if (fd >= 0) {
+				setNoDelay(fd, family);
+				const Camera& camera = currentContext->camera;
+				unsigned hello[HELLO_WORDS] = {
+					MSG_HELLO, PROTOCOL_MAGIC, (unsigned) frameWidth(), (unsigned) frameHeight(),
+					floatBits((float) camera.pos.x), floatBits((float) camera.pos.y), floatBits((float) camera.pos.z),
+					floatBits((float) camera.yaw), floatBits((float) camera.pitch), floatBits((float) camera.roll),
+					floatBits((float) camera.fov)
+				};
+				if (sendWords(fd, hello, HELLO_WORDS)) {
+					Worker w;
+					w.fd = fd;
+					w.tilesDone = 0;
+					w.lastReceived = SDL_GetTicks();
+					workers.push_back(w);
+					totalWorkers++;
+				} else close(fd);
+			}
+		}
+		
+		// results: take what has arrived, without waiting for the rest of a message
+		now = SDL_GetTicks();
+		for (int i = 0; i < (int) workers.size(); i++) {
+			Worker& w = workers[i];
+			if (FD_ISSET(w.fd, &fds)) {
+				if (recvAvailable(w.fd, w.inbox) < 0) {
+					dropWorker(workers, i--, tiles);
+					continue;
+				}
+				w.lastReceived = now;
+			}
+			int size;
+			bool bad = false;
+			while ((size = resultSize(w.inbox, tiles)) > 0 && (int) w.inbox.size() >= size) {
+				int completed;
+				if (!handleResult(w, tiles, completed)) {
+					bad = true;
+					break;
+				}
+				w.inbox.erase(w.inbox.begin(), w.inbox.begin() + size);
+				if (completed >= 0) {
+					tilesDone++;
+					totalTileTime += now - tiles[completed].issuedAt;
+				}
+			}
+			if (bad || size < 0 || (!w.inbox.empty() && now - w.lastReceived > STALL_TIMEOUT)) dropWorker(workers, i--, tiles);
+		}
+	}
+	
+	for (int i = 0; i < (int) workers.size(); i++) {
+		unsigned quit = MSG_QUIT;
+		sendWords(workers[i].fd, &quit, 1);
+		close(workers[i].fd);
+	}
+	closeListener(listenFd, address);
+	for (int i = 0; i < spawnWorkers; i++) wait(NULL);
+	printf("Distributed render: %d tiles, %d workers, %d tiles re-issued\n", (int) tiles.size(), totalWorkers, tilesReissued);
+	return ok;
+}
+
+bool runWorker(const char* address, int sceneId)
+{
+	signal(SIGPIPE, SIG_IGN);
+	// the coordinator may still be starting up; retry for a while:
+	int family;
+	int fd = connectTo(address, 50, family);
+	if (fd < 0) {
+		printf("Cannot connect to coordinator at `%s'\n", address);
+		return false;
+	}
+	setNoDelay(fd, family);
+	unsigned hello[HELLO_WORDS];
+	if (!recvWords(fd, hello, HELLO_WORDS) || hello[0] != MSG_HELLO || hello[1] != PROTOCOL_MAGIC
+	    || hello[2] > VFB_MAX_SIZE || hello[3] > VFB_MAX_SIZE) {
+		printf("Bad handshake from coordinator at `%s'\n", address);
+		close(fd);
+		return false;
+	}
+	if (!initHeadless(hello[2], hello[3])) {
+		close(fd);
+		return false;
+	}
+	generateScene(sceneId);
+	// the coordinator's camera (e.g. from --camera), not the scene's:
+	Camera& camera = currentContext->camera;
+	camera.pos = Vector(bitsFloat(hello[4]), bitsFloat(hello[5]), bitsFloat(hello[6]));
+	camera.yaw = bitsFloat(hello[7]);
+	camera.pitch = bitsFloat(hello[8]);
+	camera.roll = bitsFloat(hello[9]);
+	camera.fov = bitsFloat(hello[10]);
+	camera.beginRender();
+	// initHeadless() may have reallocated the vfb:
+	Color (*vfb)[VFB_MAX_SIZE] = currentContext->vfb;
+	
+	vector<unsigned> buff;
+	bool ok = true;
+	while (true) {
+		unsigned type;
+		if (!recvWords(fd, &type, 1)) {
+			ok = false;
+			break;
+		}
+		if (type == MSG_QUIT) break;
+		unsigned tile[5];
+		if (type != MSG_TILE || !recvWords(fd, tile, 5)) {
+			ok = false;
+			break;
+		}
+		int x0 = tile[1], y0 = tile[2], x1 = tile[3], y1 = tile[4];
+		if (x0 < 0 || y0 < 0 || x1 > frameWidth() || y1 > frameHeight() || x0 >= x1 || y0 >= y1) {
+			ok = false;
+			break;
+		}
+		renderTile(x0, y0, x1, y1);
+		buff.resize(6 + (x1 - x0) * (y1 - y0) * 3);
+		buff[0] = MSG_RESULT;
+		for (int i = 0; i < 5; i++) buff[i + 1] = tile[i];
+		int k = 6;
+		for (int y = y0; y < y1; y++)
+			for (int x = x0; x < x1; x++)
+				for (int c = 0; c < 3; c++) {
+					float f = vfb[y][x][c];
+					memcpy(&buff[k++], &f, sizeof(f));
+				}
+		for (int i = 0; i < (int) buff.size(); i++) buff[i] = htonl(buff[i]);
+		if (!sendAll(fd, &buff[0], buff.size() * sizeof(unsigned))) {
+			ok = false;
+			break;
+		}
+	}
+	close(fd);
+	freeScene();
+	closeGraphics();
+	return ok;
+}
+
+#endif // _WIN32
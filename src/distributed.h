@@ -0,0 +1,42 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2012 by Veselin Georgiev, Slavomir Kaslev et al    *
+ *   admin@raytracing-bg.net                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#ifndef __DISTRIBUTED_H__
+#define __DISTRIBUTED_H__
+
+/*
+ * Distributed rendering: a coordinator process splits the frame in tiles and hands
+ * them out to worker processes (running the same binary), over TCP or Unix-domain
+ * sockets. Addresses are given as "host:port" (or just "port", for the coordinator),
+ * or as "unix:/path/to/socket".
+ */
+
+/// renders the current scene into the vfb by distributing tiles to workers, which connect
+/// to `address'. If spawnWorkers > 0, that many local workers are started (by executing
+/// `self' with --worker, for the built-in scene sceneId). Results are read without blocking, so a worker that stalls in the middle
+/// of one doesn't hold up the others; it's dropped after a while, and its tiles are handed out again.
+/// Returns false on network errors, or if no worker is connected for a minute.
+bool renderDistributed(const char* address, int spawnWorkers, const char* self, int sceneId);
+
+/// connects to a coordinator at `address' and renders tiles of the built-in scene sceneId
+/// for it (with the coordinator's frame size and camera), until it says the frame is
+/// complete. Returns false on errors.
+bool runWorker(const char* address, int sceneId);
+
+#endif // __DISTRIBUTED_H__
@@ -20,13 +20,62 @@
 
 #include <assert.h>
 #include "geometry.h"
+#include "shading.h"
 #include "util.h"
 #include <algorithm>
 #include <stdio.h>
 using std::sort;
 
 
-bool Plane::intersect(Ray ray, IntersectionInfo& info)
+bool Node::intersect(const Ray& ray, IntersectionInfo& info)
+{
+	HitRecord hit;
+	if (!findHit(ray, hit)) return false;
+	fillInfo(ray, hit, info);
+	return true;
+}
+
+bool Node::findHit(const Ray& ray, HitRecord& hit)
+{
+	if (T.isIdentity()) return geometry->findHit(ray, hit);
+	// the object-space ray isn't normalized, so hit.distance is valid in world space, too:
+	return geometry->findHit(T.undoRay(ray), hit);
+}
+
+void Node::fillInfo(const Ray& ray, const HitRecord& hit, IntersectionInfo& info)
+{
+	HitRecord h = hit;
+	h.needUV = shader->needsUV();
+	if (T.isIdentity()) {
+		geometry->fillInfo(ray, h, info);
+		return;
+	}
+	geometry->fillInfo(T.undoRay(ray), h, info);
+	info.ip = ray.start + ray.dir * info.distance;
+	info.norm = T.normal(info.norm);
+	info.norm.normalize();
+}
+
+bool Node::getBounds(BBox& box)
+{
+	BBox local;
+	if (!geometry->getBounds(local)) return false;
+	if (T.isIdentity()) {
+		box = local;
+		return true;
+	}
+	// transform all corners of the box:
+	box.makeEmpty();
+	for (int i = 0; i < 8; i++) {
+		Vector corner((i & 1) ? local.vmax.x : local.vmin.x,
+		              (i & 2) ? local.vmax.y : local.vmin.y,
+		              (i & 4) ? local.vmax.z : local.vmin.z);
+		box.add(T.point(corner));
+	}
+	return true;
+}
+
+bool Plane::findHit(const Ray& ray, HitRecord& hit)
 {
 	// intersect a ray with a XZ plane:
 	// if the ray is (almost) parallel to the XZ plane, consider no intersection:
@@ -38,18 +87,25 @@ bool Plane::intersect(Ray ray, IntersectionInfo& info)
 	double scaling = toCover / ray.dir.y;
 	if (scaling < 0) return false; // ... and if it is, then the intersection point is behind us; bail out
 	
+	hit.distance = scaling;
+	hit.g = this;
+	hit.face = 0;
+	return true;
+}
+
+void Plane::fillInfo(const Ray& ray, const HitRecord& hit, IntersectionInfo& info)
+{
 	// calculate the intersection
-	info.ip = ray.start + ray.dir * scaling;
-	info.distance = scaling;
+	info.ip = ray.start + ray.dir * hit.distance;
+	info.distance = hit.distance;
 	info.norm = Vector(0, 1, 0);
 	info.u = info.ip.x;
 	info.v = info.ip.z;
 	info.g = this;
-	return true;
 }
 
 
-bool Sphere::intersect(Ray ray, IntersectionInfo& info)
+bool Sphere::findHit(const Ray& ray, HitRecord& hit)
 {
 	// compute the sphere intersection using a quadratic equation:
 	Vector H = ray.start - O;
@@ -65,19 +121,44 @@ bool Sphere::intersect(Ray ray, IntersectionInfo& info)
 	if (sol < 0) sol = x1; // ... but if it's behind us, opt for the other one
 	if (sol < 0) return false; // ... still behind? Then the whole sphere is behind us - no intersection.
 	
-	info.distance = sol;
-	info.ip = ray.start + ray.dir * sol;
+	hit.distance = sol;
+	hit.g = this;
+	hit.face = 0;
+	return true;
+}
+
+void Sphere::fillInfo(const Ray& ray, const HitRecord& hit, IntersectionInfo& info)
+{
+	info.distance = hit.distance;
+	info.ip = ray.start + ray.dir * hit.distance;
 	info.norm = info.ip - O; // generate the normal by getting the direction from the center to the ip
 	info.norm.normalize();
 	info.g = this;
+	if (!hit.needUV) {
+		info.u = info.v = 0;
+		return;
+	}
 	info.u = (PI + atan2(info.ip.z - O.z, info.ip.x - O.x))/(2*PI);
 	info.v = 1.0 - (PI/2 + asin((info.ip.y - O.y)/R)) / PI;
+}
+
+bool Sphere::getBounds(BBox& box)
+{
+	box.vmin = O - Vector(R, R, R);
+	box.vmax = O + Vector(R, R, R);
 	return true;
 }
 
-static void testIntersect(Ray ray, IntersectionInfo& info, Vector faceCenter, double c3, double start, double dir, Vector normal, double side)
+/// the normals of the cube sides; the face number in Cube's HitRecords indexes this
+static const Vector cubeNormals[6] = {
+	Vector(-1, 0, 0), Vector(+1, 0, 0),
+	Vector(0, -1, 0), Vector(0, +1, 0),
+	Vector(0, 0, -1), Vector(0, 0, +1),
+};
+
+static void testIntersect(const Ray& ray, HitRecord& hit, int face, Vector faceCenter, double c3, double start, double dir, double side)
 {
-	if (fabs(dot(ray.dir, normal)) < 1e-9) return;
+	if (fabs(dot(ray.dir, cubeNormals[face])) < 1e-9) return;
 	double toCover = c3 - start;
 	double scaling = toCover / dir;
 	if (scaling < 0) return;
@@ -86,48 +167,67 @@ static void testIntersect(Ray ray, IntersectionInfo& info, Vector faceCenter, do
 	distanceFromCenter = max(distanceFromCenter, fabs(faceCenter.y - ip.y));
 	distanceFromCenter = max(distanceFromCenter, fabs(faceCenter.z - ip.z));
 	if (distanceFromCenter > side/2) return;
-	if (scaling < info.distance) {
-		info.distance = scaling;
-		info.ip = ip;
-		info.norm = normal;
-		info.u = ip.x + ip.y;
-		info.v = ip.z;
+	if (scaling < hit.distance) {
+		hit.distance = scaling;
+		hit.face = face;
 	}
 }
 
-bool Cube::intersect(Ray ray, IntersectionInfo& info)
+bool Cube::findHit(const Ray& ray, HitRecord& hit)
 {
-	IntersectionInfo closest;
-	closest.distance = INF;
+	hit.distance = INF;
 	
-	testIntersect(ray, closest, Vector(O.x - side/2, O.y, O.z), O.x - side/2, ray.start.x, ray.dir.x, Vector(-1, 0, 0), side);
-	testIntersect(ray, closest, Vector(O.x + side/2, O.y, O.z), O.x + side/2, ray.start.x, ray.dir.x, Vector(+1, 0, 0), side);
+	testIntersect(ray, hit, 0, Vector(O.x - side/2, O.y, O.z), O.x - side/2, ray.start.x, ray.dir.x, side);
+	testIntersect(ray, hit, 1, Vector(O.x + side/2, O.y, O.z), O.x + side/2, ray.start.x, ray.dir.x, side);
 	
-	testIntersect(ray, closest, Vector(O.x, O.y - side/2, O.z), O.y - side/2, ray.start.y, ray.dir.y, Vector(0, -1, 0), side);
-	testIntersect(ray, closest, Vector(O.x, O.y + side/2, O.z), O.y + side/2, ray.start.y, ray.dir.y, Vector(0, +1, 0), side);
+	testIntersect(ray, hit, 2, Vector(O.x, O.y - side/2, O.z), O.y - side/2, ray.start.y, ray.dir.y, side);
+	testIntersect(ray, hit, 3, Vector(O.x, O.y + side/2, O.z), O.y + side/2, ray.start.y, ray.dir.y, side);
 	
-	testIntersect(ray, closest, Vector(O.x, O.y, O.z - side/2), O.z - side/2, ray.start.z, ray.dir.z, Vector(0, 0, -1), side);
-	testIntersect(ray, closest, Vector(O.x, O.y, O.z + side/2), O.z + side/2, ray.start.z, ray.dir.z, Vector(0, 0, +1), side);
+	testIntersect(ray, hit, 4, Vector(O.x, O.y, O.z - side/2), O.z - side/2, ray.start.z, ray.dir.z, side);
+	testIntersect(ray, hit, 5, Vector(O.x, O.y, O.z + side/2), O.z + side/2, ray.start.z, ray.dir.z, side);
 	
-	if (closest.distance < INF) {
-		info = closest;
-		info.g = this;
-		return true;
-	} else return false;
+	hit.g = this;
+	return hit.distance < INF;
+}
+
+void Cube::fillInfo(const Ray& ray, const HitRecord& hit, IntersectionInfo& info)
+{
+	info.distance = hit.distance;
+	info.ip = ray.start + ray.dir * hit.distance;
+	info.norm = cubeNormals[hit.face];
+	info.u = info.ip.x + info.ip.y;
+	info.v = info.ip.z;
+	info.g = this;
+}
+
+bool Cube::getBounds(BBox& box)
+{
+	double h = side / 2;
+	box.vmin = O - Vector(h, h, h);
+	box.vmax = O + Vector(h, h, h);
+	return true;
 }
  
-int CsgOp::findAllIntersections(Ray ray, Geometry* geom, IntersectionInfo infos[])
+/// orders the operand hits along the ray
+static bool closerHit(const HitRecord& a, const HitRecord& b)
+{
+	return a.distance < b.distance;
+}
+
+int CsgOp::findAllIntersections(Ray ray, Geometry* geom, HitRecord hits[])
 {
 	int c = 0;
 	double totalLength = 0;
 	while (true) {
-		bool ok = geom->intersect(ray, infos[c]);
+		hits[c].leaf = NULL;
+		bool ok = geom->findHit(ray, hits[c]);
 		if (!ok) break;
-		double l = infos[c].distance;
-		infos[c].distance += totalLength;
+		if (!hits[c].leaf) hits[c].leaf = hits[c].g;
+		double l = hits[c].distance;
+		hits[c].distance += totalLength;
 		totalLength += l + 1e-6;
 		Ray newRay;
-		newRay.start = infos[c].ip + ray.dir * 1e-6;
+		newRay.start = ray.start + ray.dir * (l + 1e-6);
 		newRay.dir = ray.dir;
 		ray = newRay;
 		c++;
@@ -136,29 +236,22 @@ int CsgOp::findAllIntersections(Ray ray, Geometry* geom, IntersectionInfo infos[
 	return c;
 }
 
-
-bool CsgOp::intersect(Ray ray, IntersectionInfo& ret)
+bool CsgOp::findHit(const Ray& ray, HitRecord& hit)
 {
-	IntersectionInfo li[MAX_INTERSECTIONS], ri[MAX_INTERSECTIONS];
-	IntersectionInfo all[MAX_INTERSECTIONS];
-	int nR = 0, nL = 0;
-	//
-	nL = findAllIntersections(ray, left, li);
-	nR = findAllIntersections(ray, right, ri);
+	HitRecord all[2 * MAX_INTERSECTIONS];
+	int nL = findAllIntersections(ray, left, all);
+	int nR = findAllIntersections(ray, right, all + nL);
 	bool insideL = nL % 2 != 0;
 	bool insideR = nR % 2 != 0;
-	for (int i = 0; i < nL; i++) all[i] = li[i];
-	for (int i = 0; i < nR; i++) all[i+nL] = ri[i];
 	int n = nL + nR;
-	sort(all, all + n);
+	sort(all, all + n, closerHit);
 	
 	for (int i = 0; i < n; i++) {
-		IntersectionInfo& info = all[i];
-		if (info.g == left) insideL = !insideL;
+		if (all[i].g == left) insideL = !insideL;
 		else insideR = !insideR;
 		if (boolOp(insideL, insideR)) {
-			ret = info;
-			ret.g = this;
+			hit = all[i];
+			hit.g = this;
 			return true;
 		}
 	}
@@ -166,12 +259,20 @@ bool CsgOp::intersect(Ray ray, IntersectionInfo& ret)
 	return false;
 }
 
+void CsgOp::fillInfo(const Ray& ray, const HitRecord& hit, IntersectionInfo& info)
+{
+	// the distance is along the original ray, so the operand computes the same point:
+	HitRecord h = hit;
+	h.g = hit.leaf;
+	hit.leaf->fillInfo(ray, h, info);
+	info.g = this;
+}
 
-
-
-
-
-
-
-
-
+bool CsgOp::getBounds(BBox& box)
+{
+	// the result is always inside the union of the operands:
+	BBox r;
+	if (!left->getBounds(box) || !right->getBounds(r)) return false;
+	box.add(r);
+	return true;
+}
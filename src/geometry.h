@@ -22,6 +22,8 @@
 
 
 #include "vector.h"
+#include "transform.h"
+#include "bbox.h"
 
 /// a structure, that holds all the info, which a Geometry::intersect() method
 /// may need to save when an intersection is found.
@@ -39,6 +41,17 @@ inline bool operator < (const IntersectionInfo& a, const IntersectionInfo& b)
 	return a.distance < b.distance;
 }
 
+/// the compact result of Geometry::findHit(): just enough to pick the closest hit, and to compute
+/// the full IntersectionInfo for it later (with Geometry::fillInfo()). The candidate hits, which
+/// lose to a closer one, never pay for normals, UVs and such.
+struct HitRecord {
+	double distance; //!< the distance to the intersection point along the ray
+	Geometry* g;
+	int face; //!< which part of the geometry was hit (e.g., the side of a cube); geometry-specific
+	Geometry* leaf; //!< for CSG: the operand that was actually hit (face refers to it); set by CsgOp::findHit()
+	bool needUV; //!< whether fillInfo() has to compute u, v (set by the caller, e.g. from Shader::needsUV())
+};
+
 /// An abstract class, that describes a geometry in the scene.
 class Geometry {
 public:
@@ -46,19 +59,46 @@ public:
 	
 	/// Intersect a geometry with a ray. Returns true if an intersection is found,
 	/// in which case the info structure is filled with details about the intersection.
-	virtual bool intersect(Ray ray, IntersectionInfo& info) = 0;
+	virtual bool intersect(Ray ray, IntersectionInfo& info)
+	{
+		HitRecord hit;
+		if (!findHit(ray, hit)) return false;
+		hit.needUV = true;
+		fillInfo(ray, hit, info);
+		return true;
+	}
+	
+	/// Like intersect(), but only finds the distance to the intersection (and whatever
+	/// fillInfo() needs later).
+	virtual bool findHit(const Ray& ray, HitRecord& hit) = 0;
+	
+	/// computes the full info about a hit, which findHit() returned for the same ray
+	virtual void fillInfo(const Ray& ray, const HitRecord& hit, IntersectionInfo& info) = 0;
 	
 	virtual const char* name() const = 0; //!< a virtual function, which returns the name of a geometry
+	
+	/// gets the bounding box of the geometry. Returns false if the geometry is unbounded (e.g., a plane)
+	virtual bool getBounds(BBox& box) { return false; }
 };
 
 class Shader;
 
-/// A Node, which holds a geometry, linked to a shader.
+/// A Node, which holds a geometry, linked to a shader, and placed in the world by a transform.
 class Node {
 public:
 	Node(Geometry* g, Shader* s) { geometry = g; shader = s; }
 	Geometry* geometry;
 	Shader* shader;
+	Transform T; //!< object space -> world space
+	
+	/// intersects the (world-space) ray with the transformed geometry. The resulting
+	/// info is in world space, too.
+	bool intersect(const Ray& ray, IntersectionInfo& info);
+	
+	bool findHit(const Ray& ray, HitRecord& hit); //!< like intersect(), but only finds the distance (see Geometry::findHit())
+	void fillInfo(const Ray& ray, const HitRecord& hit, IntersectionInfo& info); //!< completes a hit, found by findHit()
+	
+	bool getBounds(BBox& box); //!< the world-space bounds of the node; false if unbounded
 };
 
 /// A simple plane, parallel to the XZ plane (coinciding with XZ when y == 0)
@@ -66,7 +106,8 @@ class Plane: public Geometry {
 	double y; /// the offset of the plane from the origin along the Y axis.
 public:
 	Plane(double _y) { y = _y; }
-	bool intersect(Ray ray, IntersectionInfo& info);
+	bool findHit(const Ray& ray, HitRecord& hit);
+	void fillInfo(const Ray& ray, const HitRecord& hit, IntersectionInfo& info);
 	const char* name() const { return "Plane"; }
 };
 
@@ -76,8 +117,10 @@ class Sphere: public Geometry {
 	double R; /// the sphere's radius
 public:
 	Sphere(Vector _O, double _R) {O = _O; R = _R; }
-	bool intersect(Ray ray, IntersectionInfo& info);
+	bool findHit(const Ray& ray, HitRecord& hit);
+	void fillInfo(const Ray& ray, const HitRecord& hit, IntersectionInfo& info);
 	const char* name() const { return "Sphere"; }
+	bool getBounds(BBox& box);
 };
 
 class Cube: public Geometry {
@@ -85,18 +128,24 @@ class Cube: public Geometry {
 	double side; /// the cube's side
 public:
 	Cube(Vector _O, double _side) {O = _O; side = _side; }
-	bool intersect(Ray ray, IntersectionInfo& info);
+	bool findHit(const Ray& ray, HitRecord& hit);
+	void fillInfo(const Ray& ray, const HitRecord& hit, IntersectionInfo& info);
 	const char* name() const { return "Cube"; }
+	bool getBounds(BBox& box);
 };
 
 class CsgOp: public Geometry {
 	Geometry* left, *right;
 	static const int MAX_INTERSECTIONS = 32;
-	int findAllIntersections(Ray ray, Geometry* geom, IntersectionInfo infos[]);
+	int findAllIntersections(Ray ray, Geometry* geom, HitRecord hits[]);
 public:
 	CsgOp(Geometry* l, Geometry *r) { left = l; right = r; }
 	virtual bool boolOp(bool insideL, bool insideR) = 0;
-	bool intersect(Ray ray, IntersectionInfo& info);
+	/// the result depends on all hits of the operands; the winning one is returned, with its operand in hit.leaf
+	bool findHit(const Ray& ray, HitRecord& hit);
+	/// delegates to the operand, which findHit() recorded in hit.leaf (no re-intersection)
+	void fillInfo(const Ray& ray, const HitRecord& hit, IntersectionInfo& info);
+	bool getBounds(BBox& box);
 };
 
 class CsgUnion: public CsgOp {
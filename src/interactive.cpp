@@ -0,0 +1,179 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2012 by Veselin Georgiev, Slavomir Kaslev et al    *
+ *   admin@raytracing-bg.net                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <SDL/SDL.h>
+#include <stdio.h>
+#include "interactive.h"
+#include "context.h"
+#include "threads.h"
+#include "sdl.h"
+#include "denoise.h"
+#include "reproject.h"
+
+extern Color raytrace(Ray ray);
+extern void handleMouse(SDL_MouseButtonEvent *mev);
+
+const double FLY_SPEED = 150; //!< units per second
+const double FAST_FLY_FACTOR = 4; //!< with Shift held
+const double MOUSE_SENSITIVITY = 0.2; //!< degrees per pixel of mouse motion
+const double MAX_PITCH = 89;
+const double MAX_TIME_STEP = 0.1; //!< seconds; longer pauses (e.g., a refinement step) don't cause jumps
+const int MAX_PREVIEW_SCALE = 16;
+const int INITIAL_PREVIEW_SCALE = 4;
+const int REFINE_BAND = 32; //!< rows, refined between two checks for input
+const Uint32 IDLE_DELAY = 10; //!< ms to sleep when there's nothing to do
+
+/// traces the rows [begin..end) of preview blocks, as a parallelFor() kernel. data points to the scale.
+static void kernelPreview(int begin, int end, void* data)
+{
+	RenderContext& rc = *currentContext;
+	int scale = *(int*) data;
+	int W = rc.width, H = rc.height;
+	for (int row = begin; row < end; row++) {
+		int y0 = row * scale, y1 = y0 + scale < H ? y0 + scale : H;
+		for (int x0 = 0; x0 < W; x0 += scale) {
+			int x1 = x0 + scale < W ? x0 + scale : W;
+			// a single ray through the middle pixel of the block:
+			Color c = raytrace(rc.camera.getScreenRay(x0 + (x1 - x0) / 2, y0 + (y1 - y0) / 2));
+			for (int y = y0; y < y1; y++)
+				for (int x = x0; x < x1; x++)
+					rc.vfb[y][x] = c;
+		}
+	}
+}
+
+/// renders a preview of the current context's frame, with one ray per scale x scale pixels
+static void renderPreview(int scale)
+{
+	int rows = (frameHeight() + scale - 1) / scale;
+	parallelFor(rows, 1, kernelPreview, &scale);
+}
+
+/// picks the preview scale for the next frame, from the time (in seconds) the last one took with
+/// the given scale. The time is proportional to the number of rays, i.e. to 1 / scale^2.
+static int adaptScale(int scale, double frameTime, double targetFps)
+{
+	int result = (int) floor(scale * sqrt(frameTime * targetFps) + 0.5);
+	if (result < 1) result = 1;
+	if (result > MAX_PREVIEW_SCALE) result = MAX_PREVIEW_SCALE;
+	return result;
+}
+
+/// moves the camera according to the keys, which are held down; returns true if it moved
+static bool flyCamera(Camera& camera, double dt)
+{
+	Uint8* keys = SDL_GetKeyState(NULL);
+	Vector front = camera.getFrontDir(), right = camera.getRightDir();
+	Vector move(0, 0, 0);
+	if (keys[SDLK_w] || keys[SDLK_UP]) move = move + front;
+	if (keys[SDLK_s] || keys[SDLK_DOWN]) move = move - front;
+	if (keys[SDLK_d] || keys[SDLK_RIGHT]) move = move + right;
+	if (keys[SDLK_a] || keys[SDLK_LEFT]) move = move - right;
+	if (keys[SDLK_r]) move.y += 1;
+	if (keys[SDLK_f]) move.y -= 1;
+	if (move.lengthSqr() == 0) return false;
+	double speed = FLY_SPEED * ((keys[SDLK_LSHIFT] || keys[SDLK_RSHIFT]) ? FAST_FLY_FACTOR : 1);
+	move.normalize();
+	camera.pos = camera.pos + move * (speed * dt);
+	return true;
+}
+
+void runInteractive(double targetFps)
+{
+	RenderContext& rc = *currentContext;
+	Camera& camera = rc.camera;
+	printf("Interactive mode: W/S/A/D or the arrows fly, R/F go up/down, Shift is faster,\n");
+	printf("dragging with the left mouse button looks around, ESC quits.\n");
+	rc.prepareFrame(); // the scene and the light stay still
+	ReprojectionCache cache; //!< the last complete frame (refined, or reprojected)
+	AuxBuffers aux; //!< the primary hits of the refinement, for the cache
+	aux.resize(rc.width, rc.height);
+	int scale = INITIAL_PREVIEW_SCALE;
+	bool moved = true;
+	int band = 0; //!< the next band to be refined (-1 if the frame is complete)
+	Uint32 refineStart = 0;
+	Uint32 last = SDL_GetTicks();
+	while (1) {
+		SDL_Event ev;
+		while (SDL_PollEvent(&ev)) {
+			switch (ev.type) {
+				case SDL_QUIT:
+					return;
+				case SDL_KEYDOWN:
+					if (ev.key.keysym.sym == SDLK_ESCAPE) return;
+					handleOutputKey(ev.key.keysym.sym);
+					break;
+				case SDL_MOUSEMOTION:
+					if (ev.motion.state & SDL_BUTTON(SDL_BUTTON_LEFT)) {
+						camera.yaw -= ev.motion.xrel * MOUSE_SENSITIVITY;
+						camera.pitch -= ev.motion.yrel * MOUSE_SENSITIVITY;
+						if (camera.pitch > MAX_PITCH) camera.pitch = MAX_PITCH;
+						if (camera.pitch < -MAX_PITCH) camera.pitch = -MAX_PITCH;
+						moved = true;
+					}
+					break;
+				case SDL_MOUSEBUTTONUP:
+					if (ev.button.button == SDL_BUTTON_RIGHT) handleMouse(&ev.button);
+					break;
+				default:
+					break;
+			}
+		}
+		Uint32 now = SDL_GetTicks();
+		double dt = (now - last) / 1000.0;
+		if (dt > MAX_TIME_STEP) dt = MAX_TIME_STEP;
+		last = now;
+		if (flyCamera(camera, dt)) moved = true;
+		
+		if (moved) {
+			camera.beginRender();
+			if (cache.isValid()) {
+				// a full-resolution frame, which reuses what's still visible from the last one:
+				renderReprojected(cache);
+				displayVFB(rc.vfb);
+				// if that can't keep up, fall back to the previews (until the next refined frame):
+				if ((SDL_GetTicks() - now) / 1000.0 > 1 / targetFps) cache.invalidate();
+			} else {
+				renderPreview(scale);
+				displayVFB(rc.vfb);
+				double frameTime = (SDL_GetTicks() - now) / 1000.0;
+				scale = adaptScale(scale, frameTime, targetFps);
+			}
+			moved = false;
+			band = 0;
+			refineStart = SDL_GetTicks();
+		} else if (band >= 0) {
+			int y0 = band * REFINE_BAND;
+			int y1 = y0 + REFINE_BAND < rc.height ? y0 + REFINE_BAND : rc.height;
+			rc.auxBuffers = &aux;
+			renderContextRegion(rc, 0, y0, rc.width, y1);
+			rc.auxBuffers = NULL;
+			displayVFB(rc.vfb);
+			if (y1 < rc.height) band++;
+			else {
+				band = -1;
+				cache.store(aux);
+				printf("Refined in %.2lf seconds (previews at 1/%d resolution)\n", (SDL_GetTicks() - refineStart) / 1000.0, scale);
+			}
+		} else {
+			SDL_Delay(IDLE_DELAY);
+		}
+	}
+}
@@ -0,0 +1,37 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2012 by Veselin Georgiev, Slavomir Kaslev et al    *
+ *   admin@raytracing-bg.net                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#ifndef __INTERACTIVE_H__
+#define __INTERACTIVE_H__
+
+/// Flies the current context's camera around the scene, in the window, re-rendering continuously.
+/// While the camera moves, each frame is a quick preview: one ray (without AA) per block of
+/// scale x scale pixels. The scale follows the measured frame times, so that the previews keep up
+/// with targetFps. Once the camera stops, the frame is refined to the full resolution with AA,
+/// band by band, which is interrupted as soon as the camera moves again. After a complete frame,
+/// the next ones are rendered at full resolution with renderReprojected() (see reproject.h), as long
+/// as that keeps up with targetFps.
+///
+/// Controls: W/S/A/D or the arrows move forward, back and sideways, R/F move up and down, Shift
+/// moves faster; dragging with the left mouse button looks around. The output stage keys work
+/// (see handleOutputKey()), the right mouse button acts like a click after a normal render,
+/// and ESC quits.
+void runInteractive(double targetFps);
+
+#endif // __INTERACTIVE_H__
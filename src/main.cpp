@@ -19,103 +19,327 @@
  ***************************************************************************/
 
 #include <SDL/SDL.h>
+#include <string.h>
+#include <ctype.h>
 #include "sdl.h"
 #include "matrix.h"
 #include "camera.h"
 #include "geometry.h"
 #include "shading.h"
+#include "stats.h"
+#include "bitmap.h"
+#include "distributed.h"
+#include "animation.h"
+#include "bvh.h"
+#include "threads.h"
+#include "wavefront.h"
+#include "pathtracer.h"
+#include "budget.h"
+#include "denoise.h"
+#include "output.h"
+#include "sampler.h"
+#include "scene.h"
+#include "raydebug.h"
+#include "regress.h"
+#include "server.h"
+#include "context.h"
+#include "interactive.h"
+#include "checkpoint.h"
+#include "adaptive.h"
 
-Color vfb[VFB_MAX_SIZE][VFB_MAX_SIZE]; //!< virtual framebuffer
-bool needsAA[VFB_MAX_SIZE][VFB_MAX_SIZE];
 const float AA_THRESH = 0.1f;
-Camera camera;
-
-Geometry* geometries[100];
-Shader* shaders[100];
-Node* nodes[100];
-Texture* textures[100];
-int nGeom = 0, nShaders = 0, nNodes = 0, nTextures = 0;
 
 /// traces a ray in the scene and returns the visible light that comes from that direction
 Color raytrace(Ray ray)
 {
-	if (ray.debug) {
-		printf("  Raytrace[start = ");
-		ray.start.print();
-		printf(", dir = ");
-		ray.dir.print();
-		printf("]\n");
-	}
+	RAY_TREE(begin("ray"));
+	RAY_TREE(field("ray", ray));
 	IntersectionInfo closestInfo;
-	closestInfo.distance = INF;
-	Node* closestNode = NULL;
-	for (int i = 0; i < nNodes; i++) {
-		IntersectionInfo info;
-		if (nodes[i]->geometry->intersect(ray, info)) {
-			if (info.distance < closestInfo.distance) {
-				closestInfo = info;
-				closestNode = nodes[i];
-			}
-		}
+	Node* closestNode = currentContext->bvh.intersect(ray, closestInfo);
+	Color result(0, 0, 0);
+	if (closestNode) {
+		RAY_TREE(hit(closestNode, closestInfo));
+		result = closestNode->shader->shade(ray, closestInfo);
 	}
-	if (!closestNode) return Color(0, 0, 0);
-	else {
-		if (ray.debug) {
-			printf("    Closest node is a %s at distance %.3lf\n", closestNode->geometry->name(), closestInfo.distance);
-			printf("      ip   = "); closestInfo.ip.println();
-			printf("      norm = "); closestInfo.norm.println();
-		}
-		return closestNode->shader->shade(ray, closestInfo);
+	RAY_TREE(field("color", result));
+	RAY_TREE(end());
+	return result;
+}
+
+/// like raytrace(), for the primary ray of pixel (x, y): the hit is also recorded in the
+/// auxiliary buffers, if they're enabled
+Color raytracePrimary(Ray ray, int x, int y)
+{
+	AuxBuffers* auxBuffers = currentContext->auxBuffers;
+	if (!auxBuffers) return raytrace(ray);
+	RAY_TREE(begin("ray"));
+	RAY_TREE(field("ray", ray));
+	IntersectionInfo info;
+	Node* node = currentContext->bvh.intersect(ray, info);
+	auxBuffers->record(x, y, ray, node, info);
+	Color result(0, 0, 0);
+	if (node) {
+		RAY_TREE(hit(node, info));
+		result = node->shader->shade(ray, info);
 	}
+	RAY_TREE(field("color", result));
+	RAY_TREE(end());
+	return result;
 }
 
-static bool tooDifferent(Color a, Color b)
+static float colorDifference(Color a, Color b)
 {
-	float diff = fabs(a.r - b.r) + fabs(a.g - b.g) + fabs(a.b - b.b);
-	return (diff > AA_THRESH);
+	return fabs(a.r - b.r) + fabs(a.g - b.g) + fabs(a.b - b.b);
 }
 
-void renderScene(void)
+/// measures how much the pixel (x, y) differs from its neighbours (the largest difference
+/// between a neighbour and their average). p points to the pixel's color, and rows are `stride' colors apart.
+float aaContrast(const Color* p, int stride, int x, int y)
 {
-	const double offsets[5][2] = {
-		{ 0, 0 }, {0.3, 0.3}, {0.6, 0}, {0, 0.6}, {0.6, 0.6}
-	};
+	Color neighs[4];
+	neighs[0] = y > 0 ? p[-stride] : p[0];
+	neighs[1] = y < frameHeight() - 1 ? p[stride] : p[0];
+	neighs[2] = x > 0 ? p[-1] : p[0];
+	neighs[3] = x < frameWidth() - 1 ? p[1] : p[0];
+	Color average = (p[0] + neighs[0] + neighs[1] + neighs[2] + neighs[3]) / 5;
+	float result = 0;
+	for (int i = 0; i < 4; i++) {
+		float diff = colorDifference(neighs[i], average);
+		if (diff > result) result = diff;
+	}
+	return result;
+}
+
+/// decides whether the pixel (x, y) needs anti-aliasing, by comparing it with its neighbours.
+/// p points to the pixel's color, and rows are `stride' colors apart.
+bool needsAA(const Color* p, int stride, int x, int y)
+{
+	return aaContrast(p, stride, x, y) > AA_THRESH;
+}
 
+/// renders the rectangle [x0..x1) x [y0..y1) of the frame into the vfb, including
+/// the adaptive anti-aliasing. A one-pixel border around the rectangle is traced too
+/// (but not written to the vfb), so AA decisions at the edges are the same as in a full-frame
+/// render, and tiles can be rendered independently of each other.
+void renderTile(int x0, int y0, int x1, int y1)
+{
+	RenderContext& rc = *currentContext;
+	// the traced area, including the border:
+	int bx0 = x0 > 0 ? x0 - 1 : 0;
+	int by0 = y0 > 0 ? y0 - 1 : 0;
+	int bx1 = x1 < frameWidth() ? x1 + 1 : x1;
+	int by1 = y1 < frameHeight() ? y1 + 1 : y1;
+	int bw = bx1 - bx0;
+	Color* prim = new Color[bw * (by1 - by0)];
+	
 	//trace rays
-	for (int y = 0; y < frameHeight(); y++){
-		for (int x = 0; x < frameWidth(); x++) {
-			Ray ray = camera.getScreenRay(x, y);
-			vfb[y][x] = raytrace(ray);
-		}
-	}
-
-	//check for AA
-	for (int y = 0; y < frameHeight(); y++) {
-		for (int x = 0; x < frameWidth(); x++) {
-			Color neighs[4];
-			neighs[0] = y > 0 ? vfb[y-1][x] : vfb[y][x];
-			neighs[1] = y < frameHeight() - 1 ? vfb[y+1][x] : vfb[y][x];
-			neighs[2] = x > 0 ? vfb[y][x-1] : vfb[y][x];
-			neighs[3] = x < frameWidth() - 1 ? vfb[y][x+1] : vfb[y][x];
-			Color average = (vfb[y][x] + neighs[0] + neighs[1] + neighs[2] + neighs[3]) / 5;
-			for (int i = 0; i < 4; i++) {
-				if (tooDifferent(neighs[i], average)) needsAA[y][x] = true;
-			}
+	for (int y = by0; y < by1; y++) {
+		for (int x = bx0; x < bx1; x++) {
+			Ray ray = rc.camera.getScreenRay(x, y);
+			bool inside = x >= x0 && x < x1 && y >= y0 && y < y1; // the border belongs to other tiles
+			prim[(y - by0) * bw + (x - bx0)] = inside ? raytracePrimary(ray, x, y) : raytrace(ray);
 		}
 	}
 
-	//draw AA
-	for (int y = 0; y < frameHeight(); y++)
-		for (int x = 0; x < frameWidth(); x++) {
-			if (needsAA[y][x]) {
+	//check for AA and draw it
+	for (int y = y0; y < y1; y++) {
+		for (int x = x0; x < x1; x++) {
+			Color* p = &prim[(y - by0) * bw + (x - bx0)];
+			if (needsAA(p, bw, x, y)) {
 				Color accum = Color(0, 0, 0);
-				for (int samples = 0; samples < 5; samples++) {
-					Ray ray = camera.getScreenRay(x + offsets[samples][0], y + offsets[samples][1]);
+				for (int samples = 0; samples < AA_SAMPLES; samples++) {
+					double dx, dy;
+					getPixelSample(x, y, samples, AA_SAMPLES, dx, dy);
+					Ray ray = rc.camera.getScreenRay(x + dx, y + dy);
 					accum += raytrace(ray);
 				}
-				vfb[y][x] = accum / 5;
+				rc.vfb[y][x] = accum / AA_SAMPLES;
+			} else rc.vfb[y][x] = p[0];
+		}
+	}
+	delete [] prim;
+}
+
+/// renders the current context's frame, in tiles on all threads
+void renderScene(void)
+{
+	renderContext(*currentContext);
+}
+
+#ifdef RAY_DEBUG
+/// traces pixel (x, y) the way renderTile() does, and saves its ray tree (the primary
+/// ray, the AA samples and everything they spawned) to a JSON file
+static bool recordPixel(int x, int y, const char* filename)
+{
+	if (x < 0 || x >= frameWidth() || y < 0 || y >= frameHeight()) return false;
+	Camera& camera = currentContext->camera;
+	// the neighbours are needed for the AA decision, but they aren't recorded:
+	Color prim[3][3];
+	for (int dy = -1; dy <= 1; dy++)
+		for (int dx = -1; dx <= 1; dx++)
+			if ((dx || dy) && x + dx >= 0 && x + dx < frameWidth() && y + dy >= 0 && y + dy < frameHeight())
+				prim[dy + 1][dx + 1] = raytrace(camera.getScreenRay(x + dx, y + dy));
+	
+	RayTree tree;
+	rayTree = &tree;
+	tree.begin("pixel");
+	tree.field("x", x);
+	tree.field("y", y);
+	prim[1][1] = raytrace(camera.getScreenRay(x, y));
+	Color result = prim[1][1];
+	bool aa = needsAA(&prim[1][1], 3, x, y);
+	tree.field("needsAA", aa);
+	if (aa) {
+		Color accum = Color(0, 0, 0);
+		for (int samples = 0; samples < AA_SAMPLES; samples++) {
+			double dx, dy;
+			getPixelSample(x, y, samples, AA_SAMPLES, dx, dy);
+			tree.begin("AA sample");
+			tree.field("dx", dx);
+			tree.field("dy", dy);
+			accum += raytrace(camera.getScreenRay(x + dx, y + dy));
+			tree.end();
+		}
+		result = accum / AA_SAMPLES;
+	}
+	tree.field("color", result);
+	tree.end();
+	rayTree = NULL;
+	if (!tree.save(filename)) {
+		printf("Cannot save `%s'\n", filename);
+		return false;
+	}
+	printf("Ray tree of pixel (%d, %d) saved to `%s'\n", x, y, filename);
+	return true;
+}
+#endif // RAY_DEBUG
+
+/// A per-thread cache entry, holding the node which last blocked a shadow ray
+/// towards a given light. Adjacent shading points are usually shadowed by the
+/// same object, so testing it first resolves most shadow rays with a single intersection.
+struct ShadowCacheEntry {
+	double lx, ly, lz; //!< position of the light this entry is for
+	int sceneGeneration; //!< RenderContext::sceneGeneration of the context, the entry was filled in for
+	Node* occluder; //!< the last node, found to block the light (NULL if none)
+};
+
+const int SHADOW_CACHE_SIZE = 8; //!< how many lights are cached per thread
+static THREAD_LOCAL ShadowCacheEntry shadowCache[SHADOW_CACHE_SIZE];
+static THREAD_LOCAL int shadowCacheUsed;
+
+/// finds (or allocates) the calling thread's shadow cache entry for light l
+static ShadowCacheEntry& getShadowCacheEntry(const Vector& l)
+{
+	// generations are unique among contexts, so entries of other contexts are dropped, too:
+	int sceneGeneration = currentContext->sceneGeneration;
+	int n = shadowCacheUsed < SHADOW_CACHE_SIZE ? shadowCacheUsed : SHADOW_CACHE_SIZE;
+	for (int i = 0; i < n; i++) {
+		ShadowCacheEntry& e = shadowCache[i];
+		if (e.lx == l.x && e.ly == l.y && e.lz == l.z) {
+			if (e.sceneGeneration != sceneGeneration) {
+				e.sceneGeneration = sceneGeneration;
+				e.occluder = NULL;
 			}
+			return e;
 		}
+	}
+	// not found; take the next slot (recycling the oldest ones when there are too many lights)
+	ShadowCacheEntry& e = shadowCache[shadowCacheUsed++ % SHADOW_CACHE_SIZE];
+	e.lx = l.x;
+	e.ly = l.y;
+	e.lz = l.z;
+	e.sceneGeneration = sceneGeneration;
+	e.occluder = NULL;
+	return e;
+}
+
+/// answers a shadow query (for the point at distance `dist' from the light, in direction dir) with
+/// the current context's shadow map, if there's one for that light. Returns false if the query
+/// needs a ray after all; otherwise the answer is in `occluded'.
+static bool lookupShadowMap(const Vector& light, const Vector& dir, double dist, bool& occluded)
+{
+	const ShadowMap& shadowMap = currentContext->shadowMap;
+	if (!shadowMap.isBuiltFor(light)) return false;
+	ShadowQuery answer = shadowMap.lookup(dir, dist);
+	if (answer == SHADOW_UNSURE) return false;
+	threadStats.shadowMapHits++;
+	occluded = answer == SHADOW_OCCLUDED;
+	return true;
+}
+
+/// traces a shadow ray, which starts at a light, and returns true if it's blocked closer than maxDist
+bool isOccluded(const Ray& ray, double maxDist)
+{
+	threadStats.shadowRays++;
+	RAY_TREE(begin("shadow ray"));
+	RAY_TREE(field("ray", ray));
+	RAY_TREE(field("maxDist", maxDist));
+	bool occluded = false;
+	// the shadow map, if there's one for this light, answers most queries without tracing:
+	if (lookupShadowMap(ray.start, ray.dir, maxDist, occluded)) {
+		RAY_TREE(field("shadowMap", true));
+		RAY_TREE(field("occluded", occluded));
+		RAY_TREE(end());
+		return occluded;
+	}
+	// try the last occluder of this light first:
+	ShadowCacheEntry& cache = getShadowCacheEntry(ray.start);
+	if (cache.occluder) {
+		HitRecord hit;
+		bool found = cache.occluder->findHit(ray, hit);
+		RAY_TREE(candidate(cache.occluder, found, hit));
+		if (found && hit.distance < maxDist) {
+			threadStats.shadowCacheHits++;
+			occluded = true;
+			RAY_TREE(field("cacheHit", true));
+		}
+	}
+	if (!occluded) {
+		Node* occluder = currentContext->bvh.findOccluder(ray, maxDist, cache.occluder);
+		if (occluder) {
+			cache.occluder = occluder;
+			occluded = true;
+		}
+	}
+	RAY_TREE(field("occluded", occluded));
+	RAY_TREE(end());
+	return occluded;
+}
+
+/// like isOccluded(), for a packet of up to MAX_PACKET_SIZE shadow rays, which all start at the light
+/// (see BVH::findOccluders()): sets occluded[i] if ray i is blocked closer than maxDist[i]
+void isOccludedPacket(const Vector& light, const Vector* dirs, const double* maxDist, int count, unsigned char* occluded)
+{
+	threadStats.shadowRays += count;
+	// the rays, which neither the shadow map, nor the last occluder of the light can answer, form the packet:
+	ShadowCacheEntry& cache = getShadowCacheEntry(light);
+	Vector packetDirs[MAX_PACKET_SIZE];
+	double packetDist[MAX_PACKET_SIZE];
+	unsigned char packetOccluded[MAX_PACKET_SIZE];
+	int index[MAX_PACKET_SIZE];
+	int n = 0;
+	for (int i = 0; i < count; i++) {
+		bool blocked;
+		if (lookupShadowMap(light, dirs[i], maxDist[i], blocked)) {
+			occluded[i] = blocked;
+			continue;
+		}
+		if (cache.occluder) {
+			HitRecord hit;
+			if (cache.occluder->findHit(Ray(light, dirs[i]), hit) && hit.distance < maxDist[i]) {
+				threadStats.shadowCacheHits++;
+				occluded[i] = 1;
+				continue;
+			}
+		}
+		packetDirs[n] = dirs[i];
+		packetDist[n] = maxDist[i];
+		index[n++] = i;
+	}
+	if (n == 0) return;
+	Node* occluder = currentContext->bvh.findOccluders(light, packetDirs, packetDist, n, packetOccluded);
+	if (occluder) cache.occluder = occluder;
+	for (int k = 0; k < n; k++) occluded[index[k]] = packetOccluded[k];
 }
 
 /// checks if light (situated at point l) is visible at point p. This works
@@ -128,69 +352,644 @@ bool lightIsVisible(Vector p, Vector l)
 	ray.start = l;
 	ray.dir = LP;
 	ray.dir.normalize(); // save the length of the LP
-	for (int i = 0; i < nNodes; i++) {
-		IntersectionInfo info;
-		if (nodes[i]->geometry->intersect(ray, info)
-		    && info.distance < len - 1e-6) return false; // a hit point was found and it's closer
-		                                                 // to the light than length(LP); we're in shadow.
+	// look for a hit point, which is closer to the light than length(LP); if there's one, we're in shadow.
+	return !isOccluded(ray, len - 1e-6);
+}
+
+/// adds the primitives' showcase of scene 1: a sphere, a cube and CSG combinations of them
+static void addPrimitives(Scene& scene)
+{
+	Texture* checker = new (scene.arena) Checker(Color(0.8f, 0.1f, 0.1f), Color(0.9f, 0.9f, 0.2f), 8);
+	scene.textures.push_back(checker);
+	Shader* textured = new (scene.arena) Phong(Color(1, 1, 1), 40, checker);
+	Shader* blue = new (scene.arena) Lambert(Color(0.2f, 0.3f, 0.9f));
+	scene.shaders.push_back(textured);
+	scene.shaders.push_back(blue);
+	Geometry* sphere = new (scene.arena) Sphere(Vector(-100, 30, 250), 25);
+	Geometry* cube = new (scene.arena) Cube(Vector(100, 25, 250), 50);
+	// a cube with a spherical hollow, and a rounded cube:
+	Geometry* diff = new (scene.arena) CsgDiff(new (scene.arena) Cube(Vector(-40, 30, 180), 50),
+	                                           new (scene.arena) Sphere(Vector(-40, 30, 180), 32));
+	Geometry* inter = new (scene.arena) CsgInter(new (scene.arena) Sphere(Vector(40, 30, 180), 30),
+	                                             new (scene.arena) Cube(Vector(40, 30, 180), 45));
+	// nested: a notched sphere with a small one on top
+	Geometry* notched = new (scene.arena) CsgDiff(new (scene.arena) Sphere(Vector(0, 30, 300), 35),
+	                                              new (scene.arena) Cube(Vector(20, 50, 280), 30));
+	Geometry* onion = new (scene.arena) CsgUnion(notched, new (scene.arena) Sphere(Vector(0, 80, 300), 15));
+	Geometry* geoms[5] = { sphere, cube, diff, inter, onion };
+	Shader* shaders[5] = { textured, blue, textured, blue, textured };
+	for (int i = 0; i < 5; i++) {
+		scene.geometries.push_back(geoms[i]);
+		scene.nodes.push_back(new (scene.arena) Node(geoms[i], shaders[i]));
 	}
-	return true;
 }
 
-/// generates a scene directly, using hardcoded coordinates
-void generateScene(void)
+/// generates a scene directly, using hardcoded coordinates, into the current context.
+/// Scene 0 is the default one; scene 1 adds a few primitives on the floor.
+/// Returns false if there's no scene with that id.
+bool generateScene(int sceneId)
 {
-	geometries[0] = new Plane(0);
-	nGeom = 1;
-	shaders[0] = new Lambert(Color(0, 0.9f, 0));
-	nShaders = 1;
-	nodes[0] = new Node(geometries[0], shaders[0]);
-	nNodes = 1;
-	camera.pos = Vector(-10, 100, 0);
-	camera.aspect = 4.0/3.0;
-	camera.yaw = -10;
-	camera.pitch = -25;
-	camera.roll = 0;
-	camera.fov = 90;
-	camera.beginRender();
+	if (sceneId < 0 || sceneId >= SCENE_COUNT) {
+		printf("No such scene: %d (the scenes are 0..%d)\n", sceneId, SCENE_COUNT - 1);
+		return false;
+	}
+	RenderContext& rc = *currentContext;
+	Scene& scene = rc.scene;
+	rc.sceneChanged();
+	Geometry* plane = new (scene.arena) Plane(0);
+	scene.geometries.push_back(plane);
+	Shader* green = new (scene.arena) Lambert(Color(0, 0.9f, 0));
+	scene.shaders.push_back(green);
+	scene.nodes.push_back(new (scene.arena) Node(plane, green));
+	if (sceneId == 1) addPrimitives(scene);
+	rc.camera.pos = Vector(-10, 100, 0);
+	rc.camera.aspect = 4.0/3.0;
+	rc.camera.yaw = -10;
+	rc.camera.pitch = -25;
+	rc.camera.roll = 0;
+	rc.camera.fov = 90;
+	rc.camera.beginRender();
+
+	rc.lightPos = Vector(0, 1000, 1600);
+	rc.lightIntensity = Color(10000, 10000, 10000) * 150;
+	
+	rc.bvh.build(scene.nodes.empty() ? NULL : &scene.nodes[0], (int) scene.nodes.size());
+	return true;
+}
 
-	// lightPos and lightIntensity are defined in shading.cpp
-	extern Vector lightPos;
-	extern Color lightIntensity;
-	lightPos = Vector(0, 1000, 1600);
-	lightIntensity = Color(10000, 10000, 10000) * 150;
+/// must be called after the transform (or the parameters) of scene.nodes[index] change
+void nodeChanged(int index)
+{
+	currentContext->bvh.refit(index);
 }
 
 
-/// automatically frees all scene resources
+/// automatically frees all scene resources of the current context
 void freeScene(void)
 {
-	for (int i = 0; i < nNodes; i++) delete nodes[i];
-	for (int i = 0; i < nShaders; i++) delete shaders[i];
-	for (int i = 0; i < nTextures; i++) delete textures[i];
-	for (int i = 0; i < nGeom; i++) delete geometries[i];
+	RenderContext& rc = *currentContext;
+	rc.bvh.clear();
+	rc.scene.clear();
+	rc.sceneChanged();
 }
 
 void handleMouse(SDL_MouseButtonEvent *mev)
 {
 	printf("Mouse click from %d %d\n", (int) mev->x, (int) mev->y);
-	Ray ray = camera.getScreenRay(mev->x, mev->y);
-	ray.debug = true;
-	raytrace(ray);
-	printf("Raytracing completed!\n");
+#ifdef RAY_DEBUG
+	char filename[64];
+	sprintf(filename, "raytree_%d_%d.json", (int) mev->x, (int) mev->y);
+	recordPixel(mev->x, mev->y, filename);
+#else
+	printf("(ray trees are only recorded in builds with RAY_DEBUG defined)\n");
+#endif
 }
 
-int main(int argc, char** argv)
+/// returns true if the filename ends with the given extension (e.g. ".pfm"), ignoring the case
+static bool hasExtension(const char* filename, const char* ext)
+{
+	int n = (int) strlen(filename), m = (int) strlen(ext);
+	if (n < m) return false;
+	for (int i = 0; i < m; i++)
+		if (tolower(filename[n - m + i]) != tolower(ext[i])) return false;
+	return true;
+}
+
+/// saves the contents of the vfb to a BMP file, after the output stage; or, if the
+/// filename ends with .pfm, the raw (linear, unclamped) colors to a PFM file
+bool saveFrame(const char* filename)
+{
+	if (hasExtension(filename, ".pfm")) {
+		Bitmap bmp;
+		bmp.generateEmptyImage(frameWidth(), frameHeight());
+		for (int y = 0; y < frameHeight(); y++)
+			for (int x = 0; x < frameWidth(); x++)
+				bmp.setPixel(x, y, currentContext->vfb[y][x]);
+		if (!bmp.savePFM(filename)) {
+			printf("Cannot save `%s'\n", filename);
+			return false;
+		}
+		return true;
+	}
+	int W = frameWidth(), H = frameHeight();
+	unsigned* pixels = new unsigned[W * H];
+	quantizeFrame(currentContext->vfb, W, H, pixels, W);
+	bool ok = saveBMP(filename, pixels, W, H);
+	delete [] pixels;
+	if (!ok) printf("Cannot save `%s'\n", filename);
+	return ok;
+}
+
+/// saves the rectangle [x0..x1) x [y0..y1) of the vfb, like saveFrame() does the whole frame. If
+/// mergeFile is given, the rectangle replaces the same pixels of that (full-frame) image instead,
+/// and the result is saved. The colors are the same as in a saved full frame (the dithering
+/// of the output stage depends on the pixel's position in the frame).
+static bool saveCrop(const char* filename, int x0, int y0, int x1, int y1, const char* mergeFile)
+{
+	int W = frameWidth(), H = frameHeight();
+	bool pfm = hasExtension(filename, ".pfm");
+	Bitmap merge;
+	if (mergeFile) {
+		if (hasExtension(mergeFile, ".pfm") != pfm) {
+			printf("`%s' and `%s' must be of the same format\n", mergeFile, filename);
+			return false;
+		}
+		if (!(pfm ? merge.loadPFM(mergeFile) : merge.loadBMP(mergeFile))) return false;
+		if (merge.getWidth() != W || merge.getHeight() != H) {
+			printf("`%s' isn't %dx%d, like the frame\n", mergeFile, W, H);
+			return false;
+		}
+	}
+	// the saved image and the position of the crop in it:
+	int outW = mergeFile ? W : x1 - x0, outH = mergeFile ? H : y1 - y0;
+	int outX = mergeFile ? x0 : 0, outY = mergeFile ? y0 : 0;
+	bool ok;
+	if (pfm) {
+		Bitmap bmp;
+		bmp.generateEmptyImage(outW, outH);
+		if (mergeFile)
+			for (int y = 0; y < H; y++)
+				for (int x = 0; x < W; x++)
+					bmp.setPixel(x, y, merge.getPixel(x, y));
+		for (int y = y0; y < y1; y++)
+			for (int x = x0; x < x1; x++)
+				bmp.setPixel(outX + x - x0, outY + y - y0, currentContext->vfb[y][x]);
+		ok = bmp.savePFM(filename);
+	} else {
+		unsigned* frame = new unsigned[W * y1];
+		quantizeFrame(currentContext->vfb, W, y1, frame, W);
+		unsigned* pixels = new unsigned[outW * outH];
+		if (mergeFile)
+			for (int y = 0; y < H; y++)
+				for (int x = 0; x < W; x++)
+					pixels[y * W + x] = merge.getPixel(x, y).toRGB32();
+		for (int y = y0; y < y1; y++)
+			for (int x = x0; x < x1; x++)
+				pixels[(outY + y - y0) * outW + outX + x - x0] = frame[y * W + x];
+		ok = saveBMP(filename, pixels, outW, outH);
+		delete [] pixels;
+		delete [] frame;
+	}
+	if (!ok) printf("Cannot save `%s'\n", filename);
+	return ok;
+}
+
+// command-line options:
+static int resX = RESX, resY = RESY; //!< --size
+static bool headless = false; //!< --headless: don't open a window
+static const char* outputFile = NULL; //!< --output: save the result to this BMP
+static const char* coordinatorAddress = NULL; //!< --coordinator: distribute the frame to workers
+static int spawnWorkers = 0; //!< --spawn-workers: start that many local workers for --coordinator
+static const char* workerAddress = NULL; //!< --worker: render tiles for a coordinator
+static const char* animationFile = NULL; //!< --animation: render a sequence of frames
+static bool wavefront = false; //!< --wavefront: use renderSceneWavefront()
+static bool pathtrace = false; //!< --pathtrace: use renderProgressive()
+static int maxPasses = 0; //!< --passes: for --pathtrace
+static double timeLimit = 0; //!< --time-limit: for --pathtrace
+static double budget = 0; //!< --budget: use renderBudgeted()
+static bool adaptive = false; //!< --adaptive: use renderAdaptive()
+static bool denoise = false; //!< --denoise: run denoiseVFB() after rendering
+static const char* auxPrefix = NULL; //!< --aux: save the auxiliary buffers
+static const char* inputFile = NULL; //!< --load: post-process a saved PFM instead of rendering
+static const char* regressSuite = NULL; //!< --regress: run the regression suite in that file
+static RegressMode regressMode = REGRESS_CHECK; //!< --update-golden/--update-baseline: record instead of checking
+static bool checkTimes = false; //!< --check-times: fail the regression cases, which are slower than the baseline
+static const char* serverAddress = NULL; //!< --serve: run as a render server
+static const char* requestAddress = NULL; //!< --request: send a job to a render server
+static const char* stopAddress = NULL; //!< --stop-server: shut a render server down
+static int sceneId = 0; //!< --scene: the built-in scene to render (or to request)
+static bool customCamera = false; //!< --camera: override the scene's camera
+static Vector cameraPos;
+static double cameraYaw, cameraPitch, cameraRoll, cameraFov;
+static int shadowMapSize = 0; //!< --shadow-map: answer the shadow queries with a shadow map
+static bool interactive = false; //!< --interactive: fly around the scene
+static double targetFps = 15; //!< --target-fps: for --interactive
+static const char* checkpointFile = NULL; //!< --checkpoint: save the progress of the render there
+static double checkpointInterval = 60; //!< --checkpoint-interval: for --checkpoint
+static bool resume = false; //!< --resume: continue from the --checkpoint file
+static bool crop = false; //!< --crop: render only a rectangle of the frame
+static int cropX0, cropY0, cropX1, cropY1;
+static const char* mergeFile = NULL; //!< --merge: paste the --crop into this full-frame image
+#ifdef RAY_DEBUG
+static int debugPixelX = -1, debugPixelY = -1; //!< --debug-pixel: record the ray tree of that pixel
+#endif
+
+static void printUsage(const char* self)
+{
+	printf("Usage: %s [options]\n", self);
+	printf("  --size <W>x<H>          frame resolution (default %dx%d)\n", RESX, RESY);
+	printf("  --headless              don't open a window\n");
+	printf("  --threads <N>           number of rendering threads (default: one per CPU)\n");
+	printf("  --wavefront             trace rays in large batches, stage by stage\n");
+	printf("  --pathtrace             progressive path tracing (global illumination)\n");
+	printf("  --passes <N>            with --pathtrace: stop after N passes (samples per pixel)\n");
+	printf("  --time-limit <seconds>  with --pathtrace: stop after the pass, which crosses that time\n");
+	printf("                          (headless path tracing defaults to 16 passes)\n");
+	printf("  --budget <seconds>      finish the frame within that time: a quick first pass, then\n");
+	printf("                          anti-aliasing where it matters most, until the time is up\n");
+	printf("  --adaptive              trace a sparse grid of primary rays, refined only where the\n");
+	printf("                          hits differ; the flat areas in between are interpolated\n");
+	printf("  --denoise               filter the noise out of the rendered frame, guided by the\n");
+	printf("                          depth, normals, albedo and nodes of the primary hits\n");
+	printf("  --aux <prefix>          save the depth, normal, albedo and node buffers of the\n");
+	printf("                          primary hits to <prefix>_depth.bmp, etc.\n");
+	printf("  --sampler <name>        sub-pixel sample pattern: stratified, halton, sobol (default)\n");
+	printf("                          or bluenoise\n");
+	printf("  --shadow-map <N>        look the shadows up in a cube map of 6 x NxN depth texels,\n");
+	printf("                          built from the light each frame (exact rays only near edges)\n");
+	printf("  --checkpoint <file>     save the completed tiles (or, with --pathtrace, passes) to\n");
+	printf("                          <file> periodically, so that a killed render can be resumed\n");
+	printf("  --checkpoint-interval <seconds>\n");
+	printf("                          with --checkpoint: how often to save it (default 60)\n");
+	printf("  --resume                with --checkpoint: continue from the checkpoint, if it's there\n");
+	printf("                          (the other options must be the same as in the killed render)\n");
+	printf("  --output <file.bmp>     save the rendered frame (a .pfm file keeps the linear colors)\n");
+	printf("  --crop <x0>,<y0>,<x1>,<y1>\n");
+	printf("                          render only the pixels [x0..x1) x [y0..y1) of the frame, the\n");
+	printf("                          same as in a full render; --output then gets just those\n");
+	printf("                          (--denoise and --aux don't apply to a crop)\n");
+	printf("  --merge <file>          with --crop: paste the pixels into <file> (a full frame, saved\n");
+	printf("                          with the same output settings) and save it to --output (or\n");
+	printf("                          back to <file>)\n");
+	printf("  --load <file.pfm>       don't render: show/convert a saved frame (e.g. with new exposure)\n");
+	printf("  --exposure <stops>      brighten (or darken, if negative) the output\n");
+	printf("  --gamma <gamma>         gamma-correct the output (default 1: linear)\n");
+	printf("  --tonemap <curve>       clamp (default), reinhard or filmic\n");
+	printf("  --coordinator <addr>    distribute the frame in tiles to workers connecting at <addr>\n");
+	printf("  --spawn-workers <N>     with --coordinator: start N local workers\n");
+	printf("  --worker <addr>         render tiles for the coordinator at <addr> (give it the same\n");
+	printf("                          --scene and --sampler as the coordinator; the frame size and\n");
+	printf("                          the camera come from the coordinator)\n");
+	printf("  --animation <file>      render the frames of an animation; --output is then a pattern\n");
+	printf("                          for the frame files (default \"frame_%%04d.bmp\")\n");
+	printf("  --interactive           fly around the scene in the window (W/S/A/D, R/F, mouse drag),\n");
+	printf("                          with quick previews while moving, refined when still\n");
+	printf("  --target-fps <N>        with --interactive: the preview frame rate (default 15)\n");
+	printf("  --regress <suite.txt>   render the suite's reference views and check them against\n");
+	printf("                          the golden images and the performance baseline\n");
+	printf("  --update-golden         with --regress: record the golden images, counts and baseline\n");
+	printf("  --update-baseline       with --regress: record only this machine's baseline (times)\n");
+	printf("  --check-times           with --regress: fail the cases, which are slower than the\n");
+	printf("                          baseline allows (otherwise, they're only reported)\n");
+	printf("  --camera <x>,<y>,<z>,<yaw>,<pitch>,<roll>,<fov>\n");
+	printf("                          look from there instead of the scene's camera\n");
+	printf("  --serve <addr>          keep the scene in memory and render the jobs of clients\n");
+	printf("  --request <addr>        have the server at <addr> render a frame (with the given\n");
+	printf("                          --size, --passes, --camera and --scene) into --output\n");
+	printf("  --scene <id>            the built-in scene to render (0..%d, default 0); also for --request\n", SCENE_COUNT - 1);
+	printf("  --stop-server <addr>    shut down the server at <addr>\n");
+#ifdef RAY_DEBUG
+	printf("  --debug-pixel <X>,<Y>   save the ray tree of that pixel to raytree_<X>_<Y>.json\n");
+	printf("                          (clicking a pixel in the window does the same)\n");
+#endif
+	printf("In the window, +/- change the exposure, G toggles gamma 2.2, T cycles the tone mapping.\n");
+	printf("Addresses are \"[host:]port\" or \"unix:/path/to/socket\".\n");
+}
+
+static bool parseCommandLine(int argc, char** argv)
+{
+	for (int i = 1; i < argc; i++) {
+		const char* arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (!strcmp(arg, "--size") && hasValue) {
+			if (sscanf(argv[++i], "%dx%d", &resX, &resY) != 2 || resX <= 0 || resY <= 0
+			    || resX > VFB_MAX_SIZE || resY > VFB_MAX_SIZE) {
+				printf("Bad frame size `%s' (the maximum is %dx%d)\n", argv[i], VFB_MAX_SIZE, VFB_MAX_SIZE);
+				return false;
+			}
+		} else if (!strcmp(arg, "--headless")) {
+			headless = true;
+		} else if (!strcmp(arg, "--threads") && hasValue) {
+			setThreadCount(atoi(argv[++i]));
+		} else if (!strcmp(arg, "--wavefront")) {
+			wavefront = true;
+		} else if (!strcmp(arg, "--pathtrace")) {
+			pathtrace = true;
+		} else if (!strcmp(arg, "--passes") && hasValue) {
+			maxPasses = atoi(argv[++i]);
+		} else if (!strcmp(arg, "--time-limit") && hasValue) {
+			timeLimit = atof(argv[++i]);
+		} else if (!strcmp(arg, "--budget") && hasValue) {
+			budget = atof(argv[++i]);
+		} else if (!strcmp(arg, "--adaptive")) {
+			adaptive = true;
+		} else if (!strcmp(arg, "--denoise")) {
+			denoise = true;
+		} else if (!strcmp(arg, "--aux") && hasValue) {
+			auxPrefix = argv[++i];
+		} else if (!strcmp(arg, "--shadow-map") && hasValue) {
+			shadowMapSize = atoi(argv[++i]);
+			if (shadowMapSize < 2 || shadowMapSize > MAX_SHADOW_MAP_SIZE) {
+				printf("Bad shadow map size `%s' (2 to %d)\n", argv[i], MAX_SHADOW_MAP_SIZE);
+				return false;
+			}
+		} else if (!strcmp(arg, "--checkpoint") && hasValue) {
+			checkpointFile = argv[++i];
+		} else if (!strcmp(arg, "--checkpoint-interval") && hasValue) {
+			checkpointInterval = atof(argv[++i]);
+			if (checkpointInterval <= 0) {
+				printf("Bad checkpoint interval `%s'\n", argv[i]);
+				return false;
+			}
+		} else if (!strcmp(arg, "--resume")) {
+			resume = true;
+		} else if (!strcmp(arg, "--output") && hasValue) {
+			outputFile = argv[++i];
+		} else if (!strcmp(arg, "--crop") && hasValue) {
+			if (sscanf(argv[++i], "%d,%d,%d,%d", &cropX0, &cropY0, &cropX1, &cropY1) != 4
+			    || cropX0 < 0 || cropY0 < 0 || cropX1 <= cropX0 || cropY1 <= cropY0) {
+				printf("Bad crop rectangle `%s'\n", argv[i]);
+				return false;
+			}
+			crop = true;
+		} else if (!strcmp(arg, "--merge") && hasValue) {
+			mergeFile = argv[++i];
+		} else if (!strcmp(arg, "--sampler") && hasValue) {
+			if (!setSampler(argv[++i])) {
+				printf("Unknown sampler `%s'\n", argv[i]);
+				return false;
+			}
+		} else if (!strcmp(arg, "--load") && hasValue) {
+			inputFile = argv[++i];
+		} else if (!strcmp(arg, "--exposure") && hasValue) {
+			currentContext->postProcess.exposure = (float) atof(argv[++i]);
+		} else if (!strcmp(arg, "--gamma") && hasValue) {
+			currentContext->postProcess.gamma = (float) atof(argv[++i]);
+			if (currentContext->postProcess.gamma <= 0) {
+				printf("Bad gamma `%s'\n", argv[i]);
+				return false;
+			}
+		} else if (!strcmp(arg, "--tonemap") && hasValue) {
+			if (!currentContext->postProcess.setCurve(argv[++i])) {
+				printf("Unknown tone mapping curve `%s'\n", argv[i]);
+				return false;
+			}
+		} else if (!strcmp(arg, "--coordinator") && hasValue) {
+			coordinatorAddress = argv[++i];
+		} else if (!strcmp(arg, "--spawn-workers") && hasValue) {
+			spawnWorkers = atoi(argv[++i]);
+		} else if (!strcmp(arg, "--worker") && hasValue) {
+			workerAddress = argv[++i];
+		} else if (!strcmp(arg, "--animation") && hasValue) {
+			animationFile = argv[++i];
+		} else if (!strcmp(arg, "--interactive")) {
+			interactive = true;
+		} else if (!strcmp(arg, "--target-fps") && hasValue) {
+			targetFps = atof(argv[++i]);
+			if (targetFps <= 0) {
+				printf("Bad frame rate `%s'\n", argv[i]);
+				return false;
+			}
+		} else if (!strcmp(arg, "--regress") && hasValue) {
+			regressSuite = argv[++i];
+		} else if (!strcmp(arg, "--update-golden")) {
+			regressMode = REGRESS_UPDATE_ALL;
+		} else if (!strcmp(arg, "--update-baseline")) {
+			regressMode = REGRESS_UPDATE_BASELINE;
+		} else if (!strcmp(arg, "--check-times")) {
+			checkTimes = true;
+		} else if (!strcmp(arg, "--camera") && hasValue) {
+			if (sscanf(argv[++i], "%lf,%lf,%lf,%lf,%lf,%lf,%lf", &cameraPos.x, &cameraPos.y, &cameraPos.z,
+			           &cameraYaw, &cameraPitch, &cameraRoll, &cameraFov) != 7 || cameraFov <= 0) {
+				printf("Bad camera `%s'\n", argv[i]);
+				return false;
+			}
+			customCamera = true;
+		} else if (!strcmp(arg, "--serve") && hasValue) {
+			serverAddress = argv[++i];
+		} else if (!strcmp(arg, "--request") && hasValue) {
+			requestAddress = argv[++i];
+		} else if (!strcmp(arg, "--scene") && hasValue) {
+			sceneId = atoi(argv[++i]);
+			if (sceneId < 0 || sceneId >= SCENE_COUNT) {
+				printf("No such scene: `%s' (the scenes are 0..%d)\n", argv[i], SCENE_COUNT - 1);
+				return false;
+			}
+		} else if (!strcmp(arg, "--stop-server") && hasValue) {
+			stopAddress = argv[++i];
+#ifdef RAY_DEBUG
+		} else if (!strcmp(arg, "--debug-pixel") && hasValue) {
+			if (sscanf(argv[++i], "%d,%d", &debugPixelX, &debugPixelY) != 2) {
+				printf("Bad pixel `%s'\n", argv[i]);
+				return false;
+			}
+#endif
+		} else {
+			printUsage(argv[0]);
+			return false;
+		}
+	}
+	return true;
+}
+
+/// renders the frame with the method, chosen on the command line, and prints the timing and stats
+static bool renderFrame(const char* self)
 {
-	if (!initGraphics(RESX, RESY)) return -1;
-	generateScene();
+	AuxBuffers aux;
+	if (checkpointFile && (coordinatorAddress || (!pathtrace && (budget > 0 || wavefront || adaptive)))) {
+		printf("--checkpoint works with the default renderer and --pathtrace only; ignored\n");
+		checkpointFile = NULL;
+	}
+	if (crop && (coordinatorAddress || pathtrace || budget > 0 || wavefront || adaptive)) {
+		printf("--crop works with the default renderer only\n");
+		return false;
+	}
+	if (crop && checkpointFile) {
+		printf("A crop isn't checkpointed; --checkpoint is ignored\n");
+		checkpointFile = NULL;
+	}
+	if ((denoise || auxPrefix) && crop) {
+		// the filter would spread the black outside of the crop into its edges:
+		printf("The pixels outside of the crop have no auxiliary buffers; --denoise and --aux are ignored\n");
+		denoise = false;
+		auxPrefix = NULL;
+	}
+	if ((denoise || auxPrefix) && checkpointFile && resume) {
+		printf("The resumed parts of the frame have no auxiliary buffers; --denoise and --aux are ignored\n");
+		denoise = false;
+		auxPrefix = NULL;
+	}
+	if ((denoise || auxPrefix) && adaptive && !coordinatorAddress && !pathtrace && budget <= 0 && !wavefront) {
+		printf("The interpolated pixels have no auxiliary buffers; --denoise and --aux are ignored\n");
+		denoise = false;
+		auxPrefix = NULL;
+	}
+	if (denoise || auxPrefix) {
+		if (coordinatorAddress) {
+			printf("The workers don't send back auxiliary buffers; --denoise and --aux are ignored\n");
+			denoise = false;
+			auxPrefix = NULL;
+		} else {
+			aux.resize(frameWidth(), frameHeight());
+			currentContext->auxBuffers = &aux;
+		}
+	}
 	Uint32 ticks = SDL_GetTicks();
-	renderScene();
+	if (shadowMapSize > 0 && !coordinatorAddress) {
+		currentContext->prepareFrame();
+		printf("Shadow map time: %0.2lf seconds\n", (SDL_GetTicks() - ticks) / 1000.0);
+	}
+	if (coordinatorAddress) {
+		if (!renderDistributed(coordinatorAddress, spawnWorkers, self, sceneId)) return false;
+	} else if (pathtrace) {
+		// without a window, there's no other way to stop:
+		if (headless && maxPasses <= 0 && timeLimit <= 0) maxPasses = 16;
+		if (checkpointFile) {
+			Checkpoint checkpoint(checkpointFile, checkpointInterval, CHECKPOINT_PASSES);
+			if (resume) checkpoint.resume();
+			renderProgressive(maxPasses, timeLimit, !headless, &checkpoint);
+		} else renderProgressive(maxPasses, timeLimit, !headless);
+	} else if (budget > 0) {
+		renderBudgeted(budget);
+	} else if (wavefront) {
+		renderSceneWavefront();
+	} else if (adaptive) {
+		renderAdaptive();
+	} else if (crop) {
+		// the rest of the frame stays black:
+		for (int y = 0; y < frameHeight(); y++)
+			for (int x = 0; x < frameWidth(); x++)
+				currentContext->vfb[y][x].makeZero();
+		renderContextRegion(*currentContext, cropX0, cropY0, cropX1, cropY1);
+		printf("Rendered the %dx%d crop at (%d, %d)\n", cropX1 - cropX0, cropY1 - cropY0, cropX0, cropY0);
+	} else if (checkpointFile) {
+		Checkpoint checkpoint(checkpointFile, checkpointInterval, CHECKPOINT_TILES);
+		if (resume) checkpoint.resume();
+		int rendered = renderCheckpointed(checkpoint);
+		checkpoint.save();
+		printf("Rendered %d of %d tiles\n", rendered, checkpoint.getTileCount());
+	} else renderScene();
 	Uint32 diff = SDL_GetTicks() - ticks;
 	printf("Render time: %0.2lf seconds\n", diff / 1000.0);
-	displayVFB(vfb);
-	waitForUserExit();
+	if (denoise) {
+		ticks = SDL_GetTicks();
+		denoiseVFB(aux);
+		printf("Denoise time: %0.2lf seconds\n", (SDL_GetTicks() - ticks) / 1000.0);
+	}
+	if (auxPrefix) aux.save(auxPrefix);
+	currentContext->auxBuffers = NULL;
+	mergeThreadStats();
+	renderStats.print();
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	RenderContext mainContext;
+	currentContext = &mainContext;
+	if (!parseCommandLine(argc, argv)) return -1;
+	if (workerAddress) return runWorker(workerAddress, sceneId) ? 0 : -1;
+	if (stopAddress) return stopServer(stopAddress) ? 0 : -1;
+	if (requestAddress) {
+		RenderJob job;
+		job.sceneId = sceneId;
+		job.width = resX;
+		job.height = resY;
+		job.passes = maxPasses;
+		if (customCamera) {
+			job.pos = cameraPos;
+			job.yaw = cameraYaw;
+			job.pitch = cameraPitch;
+			job.roll = cameraRoll;
+			job.fov = cameraFov;
+		}
+		return requestRender(requestAddress, job, outputFile ? outputFile : "output.bmp") ? 0 : -1;
+	}
+	if (serverAddress) headless = true;
+	if (crop && (cropX1 > resX || cropY1 > resY)) {
+		printf("The crop rectangle doesn't fit in the %dx%d frame\n", resX, resY);
+		return -1;
+	}
+	if (mergeFile && !crop) {
+		printf("--merge needs --crop\n");
+		return -1;
+	}
+	Bitmap input;
+	if (inputFile) {
+		if (!input.loadPFM(inputFile)) return -1;
+		resX = input.getWidth();
+		resY = input.getHeight();
+		if (resX > VFB_MAX_SIZE || resY > VFB_MAX_SIZE) {
+			printf("`%s' is too large (the maximum is %dx%d)\n", inputFile, VFB_MAX_SIZE, VFB_MAX_SIZE);
+			return -1;
+		}
+	}
+	if (headless) {
+		if (!initHeadless(resX, resY)) return -1;
+	} else {
+		if (!initGraphics(resX, resY)) return -1;
+	}
+	generateScene(sceneId);
+	currentContext->shadowMapSize = shadowMapSize;
+	if (customCamera) {
+		Camera& camera = currentContext->camera;
+		camera.pos = cameraPos;
+		camera.yaw = cameraYaw;
+		camera.pitch = cameraPitch;
+		camera.roll = cameraRoll;
+		camera.fov = cameraFov;
+		camera.beginRender();
+	}
+	if (serverAddress) {
+		bool ok = runServer(serverAddress, sceneId);
+		freeScene();
+		closeThreads();
+		closeGraphics();
+		return ok ? 0 : -1;
+	}
+	if (regressSuite) {
+		bool ok = runRegression(regressSuite, regressMode, checkTimes);
+		freeScene();
+		closeThreads();
+		closeGraphics();
+		return ok ? 0 : -1;
+	}
+	if (interactive) {
+		if (headless) {
+			printf("--interactive needs a window\n");
+		} else {
+			runInteractive(targetFps);
+			currentContext->postProcess.print();
+			if (outputFile) saveFrame(outputFile);
+		}
+		freeScene();
+		closeThreads();
+		closeGraphics();
+		return headless ? -1 : 0;
+	}
+	if (animationFile) {
+		bool ok = renderAnimation(animationFile, outputFile ? outputFile : "frame_%04d.bmp", !headless);
+		freeScene();
+		closeGraphics();
+		return ok ? 0 : -1;
+	}
+	if (inputFile) {
+		for (int y = 0; y < resY; y++)
+			for (int x = 0; x < resX; x++)
+				currentContext->vfb[y][x] = input.getPixel(x, y);
+	} else if (!renderFrame(argv[0])) {
+		freeScene();
+		closeGraphics();
+		return -1;
+	}
+#ifdef RAY_DEBUG
+	if (debugPixelX >= 0) {
+		char filename[64];
+		sprintf(filename, "raytree_%d_%d.json", debugPixelX, debugPixelY);
+		recordPixel(debugPixelX, debugPixelY, filename);
+	}
+#endif
+	currentContext->postProcess.print();
+	if (crop && !inputFile) {
+		const char* filename = outputFile ? outputFile : mergeFile;
+		if (filename) saveCrop(filename, cropX0, cropY0, cropX1, cropY1, mergeFile);
+	} else if (outputFile) saveFrame(outputFile);
+	if (!headless) {
+		displayVFB(currentContext->vfb);
+		waitForUserExit();
+	}
 	freeScene();
+	closeThreads();
 	closeGraphics();
 	return 0;
 }
@@ -77,6 +77,15 @@ double determinant(const Matrix& a)
 	     - a.m[0][2] * a.m[1][1] * a.m[2][0];
 }
 
+Matrix transpose(const Matrix& a)
+{
+	Matrix result;
+	for (int i = 0; i < 3; i++)
+		for (int j = 0; j < 3; j++)
+			result.m[i][j] = a.m[j][i];
+	return result;
+}
+
 double cofactor(const Matrix& m, int ii, int jj)
 {
 	int rows[2], rc = 0, cols[2], cc = 0;
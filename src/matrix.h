@@ -48,6 +48,7 @@ inline void operator *= (Vector& v, const Matrix& a) { v = v*a; }
 Matrix operator * (const Matrix& a, const Matrix& b); //!< matrix multiplication; result = a*b
 Matrix inverseMatrix(const Matrix& a); //!< finds the inverse of a matrix (assuming it exists)
 double determinant(const Matrix& a); //!< finds the determinant of a matrix
+Matrix transpose(const Matrix& a); //!< returns the transposed matrix
 
 Matrix rotationAroundX(double angle); //!< returns a rotation matrix around the X axis; the angle is in radians
 Matrix rotationAroundY(double angle); //!< same as above, but rotate around Y
@@ -0,0 +1,180 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2012 by Veselin Georgiev, Slavomir Kaslev et al    *
+ *   admin@raytracing-bg.net                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef _WIN32
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "net.h"
+
+bool sendAll(int fd, const void* buff, int size)
+{
+	const char* p = (const char*) buff;
+	while (size > 0) {
+		int n = (int) send(fd, p, size, MSG_NOSIGNAL);
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) return false;
+		p += n;
+		size -= n;
+	}
+	return true;
+}
+
+bool recvAll(int fd, void* buff, int size)
+{
+	char* p = (char*) buff;
+	while (size > 0) {
+		int n = (int) recv(fd, p, size, 0);
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) return false;
+		p += n;
+		size -= n;
+	}
+	return true;
+}
+
+bool sendWords(int fd, const unsigned* words, int count)
+{
+	unsigned buff[16];
+	for (int i = 0; i < count; i++) buff[i] = htonl(words[i]);
+	return sendAll(fd, buff, count * sizeof(unsigned));
+}
+
+bool recvWords(int fd, unsigned* words, int count)
+{
+	if (!recvAll(fd, words, count * sizeof(unsigned))) return false;
+	for (int i = 0; i < count; i++) words[i] = ntohl(words[i]);
+	return true;
+}
+
+int recvAvailable(int fd, std::vector<unsigned char>& buff)
+{
+	unsigned char chunk[65536];
+	int total = 0;
+	while (true) {
+		int n = (int) recv(fd, chunk, sizeof(chunk), MSG_DONTWAIT);
+		if (n < 0 && errno == EINTR) continue;
+		if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return total;
+		if (n <= 0) return total ? total : -1; // report the end next time, after the data
+		buff.insert(buff.end(), chunk, chunk + n);
+		total += n;
+	}
+}
+
+/// parses an address into a sockaddr; returns the address family, or -1 on error.
+static int parseAddress(const char* address, sockaddr_storage& sa, socklen_t& len, bool listening)
+{
+	memset(&sa, 0, sizeof(sa));
+	if (!strncmp(address, "unix:", 5)) {
+		sockaddr_un* su = (sockaddr_un*) &sa;
+		if (strlen(address + 5) >= sizeof(su->sun_path)) {
+			printf("Socket path too long: `%s'\n", address + 5);
+			return -1;
+		}
+		su->sun_family = AF_UNIX;
+		strcpy(su->sun_path, address + 5);
+		len = sizeof(sockaddr_un);
+		return AF_UNIX;
+	}
+	char host[256] = "";
+	const char* colon = strrchr(address, ':');
+	const char* port = colon ? colon + 1 : address;
+	if (colon) {
+		int hostLen = colon - address;
+		if (hostLen >= (int) sizeof(host)) hostLen = sizeof(host) - 1;
+		memcpy(host, address, hostLen);
+		host[hostLen] = 0;
+	}
+	addrinfo hints, *res;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+	if (listening) hints.ai_flags = AI_PASSIVE;
+	if (getaddrinfo(host[0] ? host : NULL, port, &hints, &res) || !res) {
+		printf("Cannot resolve `%s'\n", address);
+		return -1;
+	}
+	memcpy(&sa, res->ai_addr, res->ai_addrlen);
+	len = res->ai_addrlen;
+	freeaddrinfo(res);
+	return AF_INET;
+}
+
+void setNoDelay(int fd, int family)
+{
+	if (family != AF_INET) return;
+	int one = 1;
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+int listenOn(const char* address, int& family)
+{
+	sockaddr_storage sa;
+	socklen_t saLen;
+	family = parseAddress(address, sa, saLen, true);
+	if (family < 0) return -1;
+	int fd = socket(family, SOCK_STREAM, 0);
+	if (fd < 0) {
+		printf("Cannot create socket: %s\n", strerror(errno));
+		return -1;
+	}
+	if (family == AF_UNIX) unlink(((sockaddr_un*) &sa)->sun_path);
+	int one = 1;
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	if (bind(fd, (sockaddr*) &sa, saLen) || listen(fd, 64)) {
+		printf("Cannot listen on `%s': %s\n", address, strerror(errno));
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+void closeListener(int fd, const char* address)
+{
+	close(fd);
+	if (!strncmp(address, "unix:", 5)) unlink(address + 5);
+}
+
+int connectTo(const char* address, int attempts, int& family)
+{
+	sockaddr_storage sa;
+	socklen_t saLen;
+	family = parseAddress(address, sa, saLen, false);
+	if (family < 0) return -1;
+	for (int attempt = 0; attempt < attempts; attempt++) {
+		if (attempt) usleep(100000);
+		int fd = socket(family, SOCK_STREAM, 0);
+		if (fd < 0) return -1;
+		if (!connect(fd, (sockaddr*) &sa, saLen)) return fd;
+		close(fd);
+	}
+	return -1;
+}
+
+#endif // _WIN32
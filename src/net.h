@@ -0,0 +1,63 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2012 by Veselin Georgiev, Slavomir Kaslev et al    *
+ *   admin@raytracing-bg.net                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#ifndef __NET_H__
+#define __NET_H__
+
+/*
+ * Socket helpers, shared by the distributed renderer and the render server (POSIX only).
+ * Addresses are given as "host:port" (or just "port", when listening), or as
+ * "unix:/path/to/socket". Messages are sequences of 32-bit words in network byte order.
+ */
+
+#ifndef _WIN32
+
+#include <vector>
+
+bool sendAll(int fd, const void* buff, int size); //!< sends the whole buffer; false on errors
+bool recvAll(int fd, void* buff, int size); //!< receives exactly size bytes; false on errors/EOF
+bool sendWords(int fd, const unsigned* words, int count); //!< sends up to 16 words, converted to network order
+bool recvWords(int fd, unsigned* words, int count); //!< receives words, converted to host order
+/// appends the bytes, which have already arrived, to buff, without waiting for more. Returns their
+/// count (0 if nothing is there yet), or -1 if the other side closed the connection, or on errors
+int recvAvailable(int fd, std::vector<unsigned char>& buff);
+/// reads a word (in network order) at `offset' bytes into buff
+inline unsigned wordAt(const std::vector<unsigned char>& buff, int offset)
+{
+	const unsigned char* p = &buff[offset];
+	return ((unsigned) p[0] << 24) | ((unsigned) p[1] << 16) | ((unsigned) p[2] << 8) | p[3];
+}
+
+/// creates a socket, which listens on `address'. Returns it (and its address family), or -1 on error
+int listenOn(const char* address, int& family);
+/// closes a listening socket, made by listenOn(), removing the socket file of Unix addresses
+void closeListener(int fd, const char* address);
+/// connects to `address', retrying every 100ms up to `attempts' times (the other side may still be
+/// starting up). Returns the socket (and its address family), or -1 on error
+int connectTo(const char* address, int attempts, int& family);
+
+void setNoDelay(int fd, int family); //!< disables Nagle's algorithm on TCP sockets
+
+/// floats travel as their bit patterns:
+inline unsigned floatBits(float f) { union { float f; unsigned u; } x; x.f = f; return x.u; }
+inline float bitsFloat(unsigned u) { union { float f; unsigned u; } x; x.u = u; return x.f; }
+
+#endif // _WIN32
+
+#endif // __NET_H__
@@ -0,0 +1,139 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2012 by Veselin Georgiev, Slavomir Kaslev et al    *
+ *   admin@raytracing-bg.net                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "output.h"
+#include "threads.h"
+#include "context.h"
+
+const int DITHER_SIZE = 8;
+const int GAMMA_TABLE_SIZE = 4096; //!< entries over [0..1] in the gamma lookup table
+
+static const char* curveNames[] = { "clamp", "reinhard", "filmic" };
+
+const char* PostProcess::curveName(void) const
+{
+	return curveNames[curve];
+}
+
+bool PostProcess::setCurve(const char* name)
+{
+	for (int i = 0; i < (int) (sizeof(curveNames) / sizeof(curveNames[0])); i++)
+		if (!strcmp(name, curveNames[i])) {
+			curve = (ToneMapCurve) i;
+			return true;
+		}
+	return false;
+}
+
+void PostProcess::print(void) const
+{
+	printf("Exposure: %+.1f stops, gamma: %.2f, tone mapping: %s\n", exposure, gamma, curveName());
+}
+
+/// the 8x8 Bayer matrix: the order in which the pixels of a block cross the quantization threshold
+static const int bayer[DITHER_SIZE][DITHER_SIZE] = {
+	{  0, 32,  8, 40,  2, 34, 10, 42 },
+	{ 48, 16, 56, 24, 50, 18, 58, 26 },
+	{ 12, 44,  4, 36, 14, 46,  6, 38 },
+	{ 60, 28, 52, 20, 62, 30, 54, 22 },
+	{  3, 35, 11, 43,  1, 33,  9, 41 },
+	{ 51, 19, 59, 27, 49, 17, 57, 25 },
+	{ 15, 47,  7, 39, 13, 45,  5, 37 },
+	{ 63, 31, 55, 23, 61, 29, 53, 21 }
+};
+
+struct QuantizeJob {
+	const Color (*frame)[VFB_MAX_SIZE];
+	int width;
+	unsigned* pixels;
+	int pitch;
+	int redShift, greenShift, blueShift;
+	float scale; //!< from the exposure
+	ToneMapCurve curve;
+	const float* gammaTable; //!< NULL for gamma == 1
+};
+
+/// applies the exposure, tone mapping and gamma to a color channel
+static inline float postProcessChannel(float x, const QuantizeJob* job)
+{
+	x *= job->scale;
+	if (x < 0.0f) x = 0.0f;
+	switch (job->curve) {
+		case TONEMAP_CLAMP: break;
+		case TONEMAP_REINHARD: x = x / (1.0f + x); break;
+		case TONEMAP_FILMIC: x = (x * (2.51f * x + 0.03f)) / (x * (2.43f * x + 0.59f) + 0.14f); break;
+	}
+	if (job->gammaTable) {
+		if (x > 1.0f) x = 1.0f;
+		x = job->gammaTable[(int) (x * (GAMMA_TABLE_SIZE - 1) + 0.5f)];
+	}
+	return x;
+}
+
+static inline unsigned quantizeChannel(float x, float threshold)
+{
+	float v = x * 255.0f + threshold;
+	v = v < 0.0f ? 0.0f : v;
+	v = v > 255.0f ? 255.0f : v;
+	return (unsigned) v;
+}
+
+static void kernelQuantizeRows(int begin, int end, void* data)
+{
+	const QuantizeJob* job = (const QuantizeJob*) data;
+	for (int y = begin; y < end; y++) {
+		const Color* src = job->frame[y];
+		unsigned* dest = job->pixels + y * job->pitch;
+		for (int x = 0; x < job->width; x++) {
+			// the fraction of a quantization step, added before truncation; on average, this is the
+			// same as rounding, but it breaks up the banding:
+			float t = (bayer[y % DITHER_SIZE][x % DITHER_SIZE] + 0.5f) / (DITHER_SIZE * DITHER_SIZE);
+			dest[x] = (quantizeChannel(postProcessChannel(src[x].r, job), t) << job->redShift)
+			        | (quantizeChannel(postProcessChannel(src[x].g, job), t) << job->greenShift)
+			        | (quantizeChannel(postProcessChannel(src[x].b, job), t) << job->blueShift);
+		}
+	}
+}
+
+void quantizeFrame(const Color frame[VFB_MAX_SIZE][VFB_MAX_SIZE], int width, int height,
+                   unsigned* pixels, int pitch, int redShift, int greenShift, int blueShift)
+{
+	const PostProcess& postProcess = currentContext->postProcess;
+	QuantizeJob job;
+	job.frame = frame;
+	job.width = width;
+	job.pixels = pixels;
+	job.pitch = pitch;
+	job.redShift = redShift;
+	job.greenShift = greenShift;
+	job.blueShift = blueShift;
+	job.scale = (float) pow(2.0, (double) postProcess.exposure);
+	job.curve = postProcess.curve;
+	float gammaTable[GAMMA_TABLE_SIZE];
+	job.gammaTable = NULL;
+	if (postProcess.gamma != 1 && postProcess.gamma > 0) {
+		for (int i = 0; i < GAMMA_TABLE_SIZE; i++)
+			gammaTable[i] = (float) pow(i / (double) (GAMMA_TABLE_SIZE - 1), 1.0 / postProcess.gamma);
+		job.gammaTable = gammaTable;
+	}
+	parallelFor(height, 16, kernelQuantizeRows, &job);
+}
@@ -0,0 +1,54 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2012 by Veselin Georgiev, Slavomir Kaslev et al    *
+ *   admin@raytracing-bg.net                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#ifndef __OUTPUT_H__
+#define __OUTPUT_H__
+
+#include "color.h"
+
+enum ToneMapCurve {
+	TONEMAP_CLAMP, //!< colors above 1 are clipped (the classic behaviour)
+	TONEMAP_REINHARD, //!< x / (1 + x)
+	TONEMAP_FILMIC //!< an S-curve, fitted to the ACES film response
+};
+
+/// The post-processing, which the output stage applies to the (linear, HDR) frame. Since the
+/// frame is kept, these can be changed without re-rendering.
+struct PostProcess {
+	float exposure; //!< in stops: the colors are multiplied by 2^exposure
+	float gamma; //!< the output is raised to 1/gamma (1 means linear output)
+	ToneMapCurve curve;
+	
+	PostProcess() { exposure = 0; gamma = 1; curve = TONEMAP_CLAMP; }
+	const char* curveName(void) const;
+	bool setCurve(const char* name); //!< "clamp", "reinhard" or "filmic". Returns false for anything else
+	void print(void) const; //!< prints the settings to stdout
+};
+
+/// The output stage: applies the current context's postProcess (see context.h) to the frame (of float colors) and converts it to 8-bit
+/// RGB32 pixels, for both the display and the saved images. The frame itself is left untouched.
+/// The conversion uses ordered (Bayer) dithering, so each pixel depends only on its own color
+/// and position: the rows are split among the rendering threads, and the inner loop has
+/// no dependencies between pixels, so the compiler can vectorize it.
+/// `pitch' is the distance between the rows of `pixels' (in pixels); the shifts give the
+/// positions of the channels (the defaults put blue in the least-significant byte).
+void quantizeFrame(const Color frame[VFB_MAX_SIZE][VFB_MAX_SIZE], int width, int height,
+                   unsigned* pixels, int pitch, int redShift = 16, int greenShift = 8, int blueShift = 0);
+
+#endif // __OUTPUT_H__
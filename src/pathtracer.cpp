@@ -0,0 +1,161 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2012 by Veselin Georgiev, Slavomir Kaslev et al    *
+ *   admin@raytracing-bg.net                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <SDL/SDL.h>
+#include <stdio.h>
+#include <vector>
+#include "pathtracer.h"
+#include "camera.h"
+#include "geometry.h"
+#include "shading.h"
+#include "bvh.h"
+#include "threads.h"
+#include "random.h"
+#include "stats.h"
+#include "sdl.h"
+#include "denoise.h"
+#include "sampler.h"
+#include "context.h"
+#include "checkpoint.h"
+using std::vector;
+
+extern bool lightIsVisible(Vector p, Vector l);
+
+const int RR_MIN_DEPTH = 3; //!< bounces before Russian roulette kicks in
+const float RR_MAX_SURVIVAL = 0.95f; //!< so even paths through white surfaces end eventually
+const double BOUNCE_OFFSET = 1e-4; //!< how far the bounced rays start off the surface
+
+/// returns a random direction in the hemisphere around n, with a density proportional to the cosine
+/// to n. With this density, the cosine term and the pdf of a diffuse bounce cancel out.
+static Vector cosineSample(const Vector& n, Random& rnd)
+{
+	double u1 = rnd.nextDouble(), u2 = rnd.nextDouble();
+	double r = sqrt(u1), phi = 2 * PI * u2;
+	Vector a = fabs(n.x) > 0.5 ? Vector(0, 1, 0) : Vector(1, 0, 0);
+	Vector t = a ^ n;
+	t.normalize();
+	Vector b = n ^ t;
+	return t * (r * cos(phi)) + b * (r * sin(phi)) + n * sqrt(1 - u1);
+}
+
+/// traces a single path, starting with the given ray, and returns the light it brings back.
+/// If aux is given, the first hit is recorded there, for pixel (x, y).
+static Color tracePath(Ray ray, Random& rnd, AuxBuffers* aux = NULL, int x = 0, int y = 0)
+{
+	const BVH& bvh = currentContext->bvh;
+	const Vector& lightPos = currentContext->lightPos;
+	Color result(0, 0, 0);
+	Color throughput(1, 1, 1); //!< the product of the albedos along the path so far
+	threadStats.paths++;
+	for (int depth = 0; ; depth++) {
+		IntersectionInfo info;
+		Node* node = bvh.intersect(ray, info);
+		if (depth == 0 && aux) aux->record(x, y, ray, node, info);
+		if (!node) break;
+		threadStats.pathVertices++;
+		Shader* shader = node->shader;
+		bool visible = !shader->needsShadowRay() || lightIsVisible(info.ip, lightPos);
+		result += throughput * shader->shadeDirect(ray, info, visible);
+		
+		throughput *= shader->getAlbedo(info);
+		float survival = max(throughput.r, max(throughput.g, throughput.b));
+		if (survival <= 0) break;
+		if (depth >= RR_MIN_DEPTH) {
+			if (survival > RR_MAX_SURVIVAL) survival = RR_MAX_SURVIVAL;
+			if (rnd.nextFloat() >= survival) break;
+			throughput /= survival;
+		}
+		
+		Vector n = faceforward(info.norm, ray.dir);
+		ray = Ray(info.ip + n * BOUNCE_OFFSET, cosineSample(n, rnd));
+	}
+	return result;
+}
+
+struct PassData {
+	vector<Color>* accum;
+	int width;
+	int pass;
+};
+
+static void kernelTracePass(int begin, int end, void* data)
+{
+	Camera& camera = currentContext->camera;
+	AuxBuffers* auxBuffers = currentContext->auxBuffers;
+	PassData* pd = (PassData*) data;
+	Random rnd;
+	for (int y = begin; y < end; y++) {
+		rnd.setSeed((unsigned long long) pd->pass * VFB_MAX_SIZE + y);
+		Color* row = &(*pd->accum)[y * pd->width];
+		for (int x = 0; x < pd->width; x++) {
+			double dx, dy;
+			getPixelSample(x, y, pd->pass, 0, dx, dy);
+			Ray ray = camera.getScreenRay(x + dx, y + dy);
+			row[x] += tracePath(ray, rnd, pd->pass == 0 ? auxBuffers : NULL, x, y);
+		}
+	}
+	mergeThreadStats();
+}
+
+/// writes the average of the passes so far to the vfb
+static void resolveAccumulation(const vector<Color>& accum, int W, int H, int passes)
+{
+	Color (*vfb)[VFB_MAX_SIZE] = currentContext->vfb;
+	float mult = 1.0f / passes;
+	for (int y = 0; y < H; y++)
+		for (int x = 0; x < W; x++)
+			vfb[y][x] = accum[y * W + x] * mult;
+}
+
+int renderProgressive(int maxPasses, double timeLimit, bool display, Checkpoint* checkpoint)
+{
+	Color (*vfb)[VFB_MAX_SIZE] = currentContext->vfb;
+	int W = frameWidth(), H = frameHeight();
+	vector<Color> accum(W * H, Color(0, 0, 0));
+	int passes = 0;
+	if (checkpoint && checkpoint->getPasses() > 0) {
+		accum = checkpoint->getAccumulation();
+		passes = checkpoint->getPasses();
+		resolveAccumulation(accum, W, H, passes);
+	}
+	PassData pd;
+	pd.accum = &accum;
+	pd.width = W;
+	Uint32 start = SDL_GetTicks();
+	currentContext->camera.beginRender();
+	while (passes == 0 || maxPasses <= 0 || passes < maxPasses) {
+		pd.pass = passes;
+		parallelFor(H, 1, kernelTracePass, &pd);
+		passes++;
+		resolveAccumulation(accum, W, H, passes);
+		if (checkpoint) checkpoint->passDone(accum, passes);
+		
+		double elapsed = (SDL_GetTicks() - start) / 1000.0;
+		if (display) {
+			displayVFB(vfb);
+			if (userWantsToQuit()) break;
+		}
+		if (maxPasses > 0 && passes >= maxPasses) break;
+		if (timeLimit > 0 && elapsed >= timeLimit) break;
+	}
+	if (checkpoint) checkpoint->save();
+	printf("Path tracing: %d passes (%d samples per pixel)\n", passes, passes);
+	return passes;
+}
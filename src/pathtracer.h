@@ -0,0 +1,45 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2012 by Veselin Georgiev, Slavomir Kaslev et al    *
+ *   admin@raytracing-bg.net                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#ifndef __PATHTRACER_H__
+#define __PATHTRACER_H__
+
+class Checkpoint;
+
+/// An alternative to renderScene(): a progressive Monte Carlo path tracer. Every pass traces
+/// one path per pixel (through the pass' sample of the pixel, see sampler.h, so anti-aliasing comes for free),
+/// and adds it to a floating-point accumulation buffer; the vfb holds the average of all passes
+/// so far. At each hit, the direct light is computed by the shader (Shader::shadeDirect()), and
+/// the path continues in a cosine-distributed direction, weighted by Shader::getAlbedo().
+/// Paths are terminated by Russian roulette, which keeps the estimate unbiased.
+///
+/// The passes are split in rows among the rendering threads (see parallelFor()). Random numbers
+/// come from a separate stream per row and pass, so the image doesn't depend on the thread count.
+///
+/// Stops after maxPasses passes (0 = no limit), or after the pass which crosses timeLimit seconds
+/// (0 = no limit), or when the user closes the window. If display is true, the image is shown
+/// after each pass. At least one pass is always done. Returns the number of passes.
+///
+/// If a checkpoint (of kind CHECKPOINT_PASSES) is given, the render continues from its passes
+/// (loaded with Checkpoint::resume(), if any), and the state is checkpointed after the passes;
+/// since every pass has its own random numbers, the result is the same as without the interruption.
+/// maxPasses then counts the loaded passes too (if they're enough already, no pass is done).
+int renderProgressive(int maxPasses, double timeLimit, bool display, Checkpoint* checkpoint = NULL);
+
+#endif // __PATHTRACER_H__
@@ -0,0 +1,54 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2012 by Veselin Georgiev, Slavomir Kaslev et al    *
+ *   admin@raytracing-bg.net                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#ifndef __RANDOM_H__
+#define __RANDOM_H__
+
+/// A small and fast pseudo-random generator (xorshift64*). Unlike rand(), it has no global
+/// state, so each thread (or each piece of work) can have its own stream. Streams, seeded
+/// from the same numbers, give the same results, regardless of which thread runs them.
+class Random {
+	unsigned long long state;
+public:
+	Random(unsigned long long seed = 1) { setSeed(seed); }
+	
+	/// starts a new stream. Close seeds (e.g. consecutive pixel indices) give unrelated streams.
+	void setSeed(unsigned long long seed)
+	{
+		// splitmix64 scrambling of the seed:
+		unsigned long long z = seed + 0x9E3779B97F4A7C15ULL;
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		state = z ^ (z >> 31);
+		if (!state) state = 1;
+	}
+	
+	unsigned next(void) //!< returns a random 32-bit number
+	{
+		state ^= state >> 12;
+		state ^= state << 25;
+		state ^= state >> 27;
+		return (unsigned) ((state * 2685821657736338717ULL) >> 32);
+	}
+	
+	float nextFloat(void) { return (next() >> 8) * (1.0f / 16777216.0f); } //!< returns a number in [0..1)
+	double nextDouble(void) { return next() * (1.0 / 4294967296.0); } //!< returns a number in [0..1)
+};
+
+#endif // __RANDOM_H__
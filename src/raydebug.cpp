@@ -0,0 +1,193 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2012 by Veselin Georgiev, Slavomir Kaslev et al    *
+ *   admin@raytracing-bg.net                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "raydebug.h"
+
+#ifdef RAY_DEBUG
+
+#include <string.h>
+#include "geometry.h"
+#include "scene.h"
+#include "context.h"
+using std::string;
+
+THREAD_LOCAL RayTree* rayTree = NULL;
+
+RayTree::Record::Record(const char* _type, Record* _parent)
+{
+	type = _type;
+	parent = _parent;
+}
+
+RayTree::Record::~Record()
+{
+	for (int i = 0; i < (int) children.size(); i++) delete children[i];
+}
+
+static void writeIndent(FILE* f, int indent)
+{
+	for (int i = 0; i < indent; i++) fprintf(f, "  ");
+}
+
+void RayTree::Record::write(FILE* f, int indent) const
+{
+	writeIndent(f, indent);
+	fprintf(f, "{\n");
+	writeIndent(f, indent + 1);
+	fprintf(f, "\"type\": \"%s\"", type.c_str());
+	for (int i = 0; i < (int) fields.size(); i++) {
+		fprintf(f, ",\n");
+		writeIndent(f, indent + 1);
+		fprintf(f, "%s", fields[i].c_str());
+	}
+	if (!children.empty()) {
+		fprintf(f, ",\n");
+		writeIndent(f, indent + 1);
+		fprintf(f, "\"children\": [\n");
+		for (int i = 0; i < (int) children.size(); i++) {
+			children[i]->write(f, indent + 2);
+			fprintf(f, i + 1 < (int) children.size() ? ",\n" : "\n");
+		}
+		writeIndent(f, indent + 1);
+		fprintf(f, "]");
+	}
+	fprintf(f, "\n");
+	writeIndent(f, indent);
+	fprintf(f, "}");
+}
+
+RayTree::RayTree(): root("trace", NULL)
+{
+	current = &root;
+}
+
+void RayTree::begin(const char* type)
+{
+	Record* r = new Record(type, current);
+	current->children.push_back(r);
+	current = r;
+}
+
+void RayTree::end(void)
+{
+	if (current->parent) current = current->parent;
+}
+
+void RayTree::add(const char* key, const string& value)
+{
+	current->fields.push_back(string("\"") + key + "\": " + value);
+}
+
+void RayTree::field(const char* key, bool value)
+{
+	add(key, value ? "true" : "false");
+}
+
+void RayTree::field(const char* key, int value)
+{
+	char s[32];
+	sprintf(s, "%d", value);
+	add(key, s);
+}
+
+void RayTree::field(const char* key, double value)
+{
+	char s[32];
+	// JSON has no infinities:
+	if (value >= INF) strcpy(s, "\"inf\"");
+	else sprintf(s, "%.9g", value);
+	add(key, s);
+}
+
+void RayTree::field(const char* key, const char* value)
+{
+	string s = "\"";
+	for (const char* p = value; *p; p++) {
+		if (*p == '"' || *p == '\\') s += '\\';
+		s += *p;
+	}
+	add(key, s + "\"");
+}
+
+void RayTree::field(const char* key, const Vector& value)
+{
+	char s[100];
+	sprintf(s, "[%.9g, %.9g, %.9g]", value.x, value.y, value.z);
+	add(key, s);
+}
+
+void RayTree::field(const char* key, const Color& value)
+{
+	char s[100];
+	sprintf(s, "[%.6g, %.6g, %.6g]", value.r, value.g, value.b);
+	add(key, s);
+}
+
+void RayTree::field(const char* key, const Ray& value)
+{
+	char s[200];
+	sprintf(s, "{\"start\": [%.9g, %.9g, %.9g], \"dir\": [%.9g, %.9g, %.9g]}",
+		value.start.x, value.start.y, value.start.z, value.dir.x, value.dir.y, value.dir.z);
+	add(key, s);
+}
+
+/// names a node by its geometry and its index in the scene, e.g. "Sphere #3"
+string RayTree::nodeName(const Node* node)
+{
+	const Scene& scene = currentContext->scene;
+	if (nodeIndex.empty())
+		for (int i = 0; i < (int) scene.nodes.size(); i++) nodeIndex[scene.nodes[i]] = i;
+	std::map<const Node*, int>::const_iterator it = nodeIndex.find(node);
+	int index = it == nodeIndex.end() ? -1 : it->second;
+	char s[100];
+	sprintf(s, "%s #%d", node->geometry->name(), index);
+	return s;
+}
+
+void RayTree::candidate(const Node* node, bool found, const HitRecord& hit)
+{
+	begin("candidate");
+	field("node", nodeName(node).c_str());
+	field("found", found);
+	if (found) field("distance", hit.distance);
+	end();
+}
+
+void RayTree::hit(const Node* node, const IntersectionInfo& info)
+{
+	field("hitNode", nodeName(node).c_str());
+	field("distance", info.distance);
+	field("ip", info.ip);
+	field("normal", info.norm);
+	field("u", info.u);
+	field("v", info.v);
+}
+
+bool RayTree::save(const char* filename) const
+{
+	FILE* f = fopen(filename, "wt");
+	if (!f) return false;
+	root.write(f, 0);
+	fprintf(f, "\n");
+	fclose(f);
+	return true;
+}
+
+#endif // RAY_DEBUG
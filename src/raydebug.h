@@ -0,0 +1,100 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2012 by Veselin Georgiev, Slavomir Kaslev et al    *
+ *   admin@raytracing-bg.net                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#ifndef __RAYDEBUG_H__
+#define __RAYDEBUG_H__
+
+/**
+ * @File raydebug.h
+ * @Brief Ray tree recording for debugging.
+ *
+ * The tracing code is instrumented with RAY_TREE(...) statements. In builds with RAY_DEBUG
+ * defined (it's implied by _DEBUG), they record everything that happens while the calling
+ * thread has a recorder installed in rayTree: rays, candidate intersection tests, shadow
+ * rays and shading terms, as a tree, which can be saved in JSON. Otherwise, RAY_TREE(...)
+ * expands to nothing, so the production build has no trace of it on the hot path.
+ */
+
+#if defined(_DEBUG) && !defined(RAY_DEBUG)
+#	define RAY_DEBUG
+#endif
+
+#ifdef RAY_DEBUG
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <map>
+#include "util.h"
+#include "color.h"
+#include "vector.h"
+
+class Node;
+struct IntersectionInfo;
+struct HitRecord;
+
+class RayTree {
+	struct Record {
+		std::string type;
+		std::vector<std::string> fields; //!< already formatted as `"key": value'
+		std::vector<Record*> children;
+		Record* parent;
+		
+		Record(const char* type, Record* parent);
+		~Record();
+		void write(FILE* f, int indent) const;
+	};
+	Record root;
+	Record* current;
+	std::map<const Node*, int> nodeIndex; //!< the index of each node in scene.nodes (filled on first use)
+	
+	void add(const char* key, const std::string& value);
+	std::string nodeName(const Node* node);
+	RayTree(const RayTree&);
+	RayTree& operator = (const RayTree&);
+public:
+	RayTree();
+	
+	void begin(const char* type); //!< opens a child record of the current one
+	void end(void); //!< closes the current record
+	
+	void field(const char* key, bool value);
+	void field(const char* key, int value);
+	void field(const char* key, double value);
+	void field(const char* key, const char* value);
+	void field(const char* key, const Vector& value);
+	void field(const char* key, const Color& value);
+	void field(const char* key, const Ray& value);
+	
+	/// records a candidate intersection test against a node (the hit is only used if found is true)
+	void candidate(const Node* node, bool found, const HitRecord& hit);
+	/// records the closest hit of a ray
+	void hit(const Node* node, const IntersectionInfo& info);
+	
+	bool save(const char* filename) const; //!< writes the tree in JSON
+};
+
+extern THREAD_LOCAL RayTree* rayTree; //!< the recorder of the calling thread (NULL if not recording)
+
+#	define RAY_TREE(call) do { if (rayTree) rayTree->call; } while (0)
+#else
+#	define RAY_TREE(call) do {} while (0)
+#endif // RAY_DEBUG
+
+#endif // __RAYDEBUG_H__
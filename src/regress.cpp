@@ -0,0 +1,355 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2012 by Veselin Georgiev, Slavomir Kaslev et al    *
+ *   admin@raytracing-bg.net                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <SDL/SDL.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include "regress.h"
+#include "camera.h"
+#include "bitmap.h"
+#include "stats.h"
+#include "sdl.h"
+#include "wavefront.h"
+#include "pathtracer.h"
+#include "context.h"
+using std::string;
+using std::vector;
+
+extern void renderScene(void);
+extern bool generateScene(int sceneId);
+extern void freeScene(void);
+
+enum RegressMethod {
+	METHOD_SCANLINE,
+	METHOD_WAVEFRONT,
+	METHOD_PATHTRACE
+};
+
+static const char* methodNames[] = { "scanline", "wavefront", "pathtrace" };
+
+struct RegressCase {
+	string name;
+	RegressMethod method;
+	int scene; //!< the built-in scene (see generateScene()), set by the last `scene' line before the case
+	Vector pos;
+	double yaw, pitch, roll, fov;
+};
+
+/// what a case measured: the time and the counters, which are compared against the baseline
+struct RegressResult {
+	double seconds;
+	long long rays, intersectionTests, shadowRays;
+	bool found; //!< for the recorded results: was the case in the file
+};
+
+struct RegressSuite {
+	double minPSNR, maxError, timeTolerance, countTolerance;
+	int repeat, passes;
+	int width, height; //!< the frame size of the renders; 0 keeps the current one
+	vector<RegressCase> cases;
+	
+	RegressSuite() {
+		minPSNR = 60;
+		maxError = 0.05;
+		timeTolerance = 25;
+		countTolerance = 1;
+		repeat = 3;
+		passes = 4;
+		width = height = 0;
+	}
+	bool load(const char* filename);
+};
+
+bool RegressSuite::load(const char* filename)
+{
+	FILE* f = fopen(filename, "rt");
+	if (!f) {
+		printf("Cannot open regression suite `%s'\n", filename);
+		return false;
+	}
+	char line[1024];
+	int lineNo = 0;
+	int scene = 0;
+	bool ok = true;
+	while (ok && fgets(line, sizeof(line), f)) {
+		lineNo++;
+		char keyword[32];
+		if (sscanf(line, "%31s", keyword) != 1 || keyword[0] == '#') continue;
+		if (!strcmp(keyword, "psnr")) {
+			ok = sscanf(line, "%*s %lf", &minPSNR) == 1;
+		} else if (!strcmp(keyword, "max-error")) {
+			ok = sscanf(line, "%*s %lf", &maxError) == 1;
+		} else if (!strcmp(keyword, "time-tolerance")) {
+			ok = sscanf(line, "%*s %lf", &timeTolerance) == 1;
+		} else if (!strcmp(keyword, "count-tolerance")) {
+			ok = sscanf(line, "%*s %lf", &countTolerance) == 1;
+		} else if (!strcmp(keyword, "repeat")) {
+			ok = sscanf(line, "%*s %d", &repeat) == 1 && repeat > 0;
+		} else if (!strcmp(keyword, "passes")) {
+			ok = sscanf(line, "%*s %d", &passes) == 1 && passes > 0;
+		} else if (!strcmp(keyword, "size")) {
+			ok = sscanf(line, "%*s %dx%d", &width, &height) == 2 && width > 0 && height > 0
+			     && width <= VFB_MAX_SIZE && height <= VFB_MAX_SIZE;
+		} else if (!strcmp(keyword, "scene")) {
+			ok = sscanf(line, "%*s %d", &scene) == 1 && scene >= 0 && scene < SCENE_COUNT;
+		} else if (!strcmp(keyword, "case")) {
+			RegressCase c;
+			char name[256], method[32];
+			ok = sscanf(line, "%*s %255s %31s %lf %lf %lf %lf %lf %lf %lf", name, method, &c.pos.x, &c.pos.y, &c.pos.z,
+			            &c.yaw, &c.pitch, &c.roll, &c.fov) == 9;
+			if (ok) {
+				int m = 0;
+				while (m < (int) (sizeof(methodNames) / sizeof(methodNames[0])) && strcmp(method, methodNames[m])) m++;
+				if (m == (int) (sizeof(methodNames) / sizeof(methodNames[0]))) {
+					printf("%s:%d: unknown method `%s'\n", filename, lineNo, method);
+					fclose(f);
+					return false;
+				}
+				c.name = name;
+				c.method = (RegressMethod) m;
+				c.scene = scene;
+				cases.push_back(c);
+			}
+		} else ok = false;
+		if (!ok) printf("%s:%d: syntax error\n", filename, lineNo);
+	}
+	fclose(f);
+	if (ok && cases.empty()) {
+		printf("%s: no cases\n", filename);
+		ok = false;
+	}
+	return ok;
+}
+
+/// renders a case into the vfb; the time is the best of `repeat' renders
+static RegressResult renderCase(const RegressSuite& suite, const RegressCase& c)
+{
+	Camera& camera = currentContext->camera;
+	camera.pos = c.pos;
+	camera.yaw = c.yaw;
+	camera.pitch = c.pitch;
+	camera.roll = c.roll;
+	camera.fov = c.fov;
+	camera.aspect = frameWidth() / (double) frameHeight();
+	camera.beginRender();
+	RegressResult result;
+	result.seconds = 1e99;
+	for (int i = 0; i < suite.repeat; i++) {
+		mergeThreadStats();
+		renderStats.reset();
+		Uint32 ticks = SDL_GetTicks();
+		switch (c.method) {
+			case METHOD_SCANLINE: renderScene(); break;
+			case METHOD_WAVEFRONT: renderSceneWavefront(); break;
+			case METHOD_PATHTRACE: renderProgressive(suite.passes, 0, false); break;
+		}
+		double seconds = (SDL_GetTicks() - ticks) / 1000.0;
+		if (seconds < result.seconds) result.seconds = seconds;
+		mergeThreadStats();
+	}
+	result.rays = renderStats.rays;
+	result.intersectionTests = renderStats.intersectionTests;
+	result.shadowRays = renderStats.shadowRays;
+	result.found = true;
+	return result;
+}
+
+/// loads the recorded times (baseline.txt, if times is set) or counters (counts.txt) of the cases;
+/// cases, which aren't there, get found = false
+static void loadRecord(const string& filename, bool times, const RegressSuite& suite, vector<RegressResult>& record)
+{
+	RegressResult missing;
+	memset(&missing, 0, sizeof(missing));
+	record.assign(suite.cases.size(), missing);
+	FILE* f = fopen(filename.c_str(), "rt");
+	if (!f) return;
+	char line[1024];
+	while (fgets(line, sizeof(line), f)) {
+		char name[256];
+		RegressResult r = missing;
+		if (line[0] == '#') continue;
+		if (times) {
+			if (sscanf(line, "%255s %lf", name, &r.seconds) != 2) continue;
+		} else {
+			if (sscanf(line, "%255s %lld %lld %lld", name, &r.rays, &r.intersectionTests, &r.shadowRays) != 4) continue;
+		}
+		r.found = true;
+		for (int i = 0; i < (int) suite.cases.size(); i++)
+			if (suite.cases[i].name == name) record[i] = r;
+	}
+	fclose(f);
+}
+
+/// saves the times (baseline.txt) or the counters (counts.txt) of the cases
+static bool saveRecord(const string& filename, bool times, const RegressSuite& suite, const vector<RegressResult>& results)
+{
+	FILE* f = fopen(filename.c_str(), "wt");
+	if (!f) {
+		printf("Cannot save `%s'\n", filename.c_str());
+		return false;
+	}
+	if (times) fprintf(f, "# name seconds (at %dx%d, on this machine)\n", frameWidth(), frameHeight());
+	else fprintf(f, "# name rays intersection-tests shadow-rays (at %dx%d)\n", frameWidth(), frameHeight());
+	for (int i = 0; i < (int) results.size(); i++) {
+		const RegressResult& r = results[i];
+		if (times) fprintf(f, "%s %.3lf\n", suite.cases[i].name.c_str(), r.seconds);
+		else fprintf(f, "%s %lld %lld %lld\n", suite.cases[i].name.c_str(), r.rays, r.intersectionTests, r.shadowRays);
+	}
+	fclose(f);
+	return true;
+}
+
+/// compares the vfb with a golden image. Returns false if they don't even have the same size
+static bool compareWithGolden(const Bitmap& golden, double& psnr, double& maxError)
+{
+	Color (*vfb)[VFB_MAX_SIZE] = currentContext->vfb;
+	int W = frameWidth(), H = frameHeight();
+	if (golden.getWidth() != W || golden.getHeight() != H) return false;
+	double sum = 0;
+	maxError = 0;
+	for (int y = 0; y < H; y++) {
+		for (int x = 0; x < W; x++) {
+			Color g = golden.getPixel(x, y);
+			const Color& c = vfb[y][x];
+			double d[3] = { c.r - g.r, c.g - g.g, c.b - g.b };
+			for (int i = 0; i < 3; i++) {
+				sum += d[i] * d[i];
+				if (fabs(d[i]) > maxError) maxError = fabs(d[i]);
+			}
+		}
+	}
+	double mse = sum / (3.0 * W * H);
+	// the peak signal is 1 (white); a perfect match is reported as infinity
+	psnr = mse > 0 ? 10 * log10(1 / mse) : INF;
+	return true;
+}
+
+/// checks a measurement against its baseline value with the given tolerance (in percents)
+static bool checkRegression(const char* what, double value, double base, double tolerance)
+{
+	double change = base > 0 ? 100 * (value - base) / base : (value > 0 ? INF : 0);
+	bool ok = change <= tolerance;
+	printf(", %s %+.1lf%%%s", what, change, ok ? "" : " (!)");
+	return ok;
+}
+
+bool runRegression(const char* suiteFile, RegressMode mode, bool checkTimes)
+{
+	RegressSuite suite;
+	if (!suite.load(suiteFile)) return false;
+	if (suite.width) currentContext->resize(suite.width, suite.height);
+	Color (*vfb)[VFB_MAX_SIZE] = currentContext->vfb; // after the resize, which may reallocate it
+	// the golden images and the baseline are kept next to the suite:
+	string dir = suiteFile;
+	size_t slash = dir.find_last_of("/\\");
+	dir = slash == string::npos ? "" : dir.substr(0, slash + 1);
+	string baselineFile = dir + "baseline.txt", countsFile = dir + "counts.txt";
+	vector<RegressResult> baseline, counts;
+	if (mode == REGRESS_CHECK) {
+		loadRecord(baselineFile, true, suite, baseline);
+		loadRecord(countsFile, false, suite, counts);
+	}
+	bool missingBaseline = false;
+	int slow = 0;
+	
+	vector<RegressResult> results;
+	int failed = 0;
+	int loadedScene = -1;
+	for (int i = 0; i < (int) suite.cases.size(); i++) {
+		const RegressCase& c = suite.cases[i];
+		if (c.scene != loadedScene) {
+			freeScene();
+			generateScene(c.scene);
+			loadedScene = c.scene;
+		}
+		RegressResult r = renderCase(suite, c);
+		results.push_back(r);
+		string goldenFile = dir + c.name + ".pfm";
+		printf("%-20s %-10s %6.3lf s", c.name.c_str(), methodNames[c.method], r.seconds);
+		if (mode == REGRESS_UPDATE_BASELINE) {
+			printf(", timed\n");
+			continue;
+		}
+		if (mode == REGRESS_UPDATE_ALL) {
+			Bitmap bmp;
+			bmp.generateEmptyImage(frameWidth(), frameHeight());
+			for (int y = 0; y < frameHeight(); y++)
+				for (int x = 0; x < frameWidth(); x++)
+					bmp.setPixel(x, y, vfb[y][x]);
+			if (bmp.savePFM(goldenFile.c_str())) printf(", recorded\n");
+			else {
+				printf(", cannot save `%s'\n", goldenFile.c_str());
+				failed++;
+			}
+			continue;
+		}
+		bool ok = true;
+		Bitmap golden;
+		double psnr, maxError;
+		if (!golden.loadPFM(goldenFile.c_str())) {
+			printf(", no golden image");
+			ok = false;
+		} else if (!compareWithGolden(golden, psnr, maxError)) {
+			printf(", golden image is %dx%d", golden.getWidth(), golden.getHeight());
+			ok = false;
+		} else {
+			if (psnr >= INF) printf(", exact");
+			else printf(", PSNR %.1lf dB, max error %.4lf", psnr, maxError);
+			if (psnr < suite.minPSNR || maxError > suite.maxError) {
+				printf(" (!)");
+				ok = false;
+			}
+		}
+		if (!baseline[i].found) {
+			// the golden data is shared, but the baseline is per machine; it may not be recorded yet
+			printf(", no baseline");
+			missingBaseline = true;
+		} else if (!checkRegression("time", r.seconds, baseline[i].seconds, suite.timeTolerance)) {
+			// short renders are noisy, so by default this is only reported
+			if (checkTimes) ok = false;
+			else slow++;
+		}
+		if (!counts[i].found) {
+			printf(", no counts");
+			ok = false;
+		} else {
+			const RegressResult& c = counts[i];
+			ok = checkRegression("rays", (double) r.rays, (double) c.rays, suite.countTolerance) && ok;
+			ok = checkRegression("tests", (double) r.intersectionTests, (double) c.intersectionTests, suite.countTolerance) && ok;
+			ok = checkRegression("shadow rays", (double) r.shadowRays, (double) c.shadowRays, suite.countTolerance) && ok;
+		}
+		printf(": %s\n", ok ? "PASS" : "FAIL");
+		if (!ok) failed++;
+	}
+	if (mode != REGRESS_CHECK) {
+		if (!saveRecord(baselineFile, true, suite, results)) return false;
+		if (mode == REGRESS_UPDATE_ALL && !saveRecord(countsFile, false, suite, results)) return false;
+		printf("Recorded %d case(s) in %s\n", (int) suite.cases.size(), dir.empty() ? "." : dir.c_str());
+		return failed == 0;
+	}
+	if (failed) printf("%d of %d case(s) FAILED\n", failed, (int) suite.cases.size());
+	else printf("All %d case(s) passed\n", (int) suite.cases.size());
+	if (missingBaseline) printf("The times weren't checked; record this machine's baseline with --update-baseline\n");
+	if (slow) printf("%d case(s) slower than the baseline allows (a failure only with --check-times)\n", slow);
+	return failed == 0;
+}
@@ -0,0 +1,64 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2012 by Veselin Georgiev, Slavomir Kaslev et al    *
+ *   admin@raytracing-bg.net                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#ifndef __REGRESS_H__
+#define __REGRESS_H__
+
+/*
+ * Golden-image regression testing. A suite file lists reference renders of the scene,
+ * and the tolerances they're checked with:
+ *
+ *     # comments start with '#'
+ *     psnr 60                 # minimum PSNR against the golden image, in dB (default 60)
+ *     max-error 0.05          # maximum difference of any color channel (default 0.05)
+ *     time-tolerance 25       # the render time may exceed the baseline by 25% (default)
+ *     count-tolerance 1       # same for the ray and intersection test counts (default 1%)
+ *     repeat 3                # the best time of 3 renders is taken (default 3)
+ *     passes 4                # passes of the "pathtrace" method (default 4)
+ *     size 160x120            # the frame size of the renders (default: the current one)
+ *     # case <name> <method> <x> <y> <z> <yaw> <pitch> <roll> <fov>
+ *     case overview scanline   -10 100 0   -10 -25 0 90
+ *     case low-wf   wavefront  0 20 -50    0 -5 0 60
+ *     scene 1                 # the following cases render scene 1
+ *     case prims    scanline   -10 100 0   -10 -25 0 90
+ *
+ * Cases render the built-in scene given by the last `scene <id>' line before them (scene 0
+ * if there's none; see generateScene()); the suite replaces the current scene with them (and,
+ * with `size', changes the frame size).
+ * The methods are scanline (renderScene()), wavefront and pathtrace. The golden data (the
+ * images, <name>.pfm, and counts.txt: the ray and intersection test counts of every case)
+ * and the baseline (baseline.txt: the time of every case) are kept next to the suite file.
+ * The golden data is shared (it's in the source tree), while the times are only comparable
+ * on one machine, so each machine records its own baseline (REGRESS_UPDATE_BASELINE); until
+ * it does, the times aren't checked. Short renders vary in time more than any sensible
+ * tolerance, so a slow case is only reported, unless checkTimes is set.
+ */
+
+enum RegressMode {
+	REGRESS_CHECK, //!< check the renders against the golden images and the baseline
+	REGRESS_UPDATE_BASELINE, //!< only record this machine's baseline
+	REGRESS_UPDATE_ALL //!< record the golden data and the baseline
+};
+
+/// runs (or records, depending on mode) the regression suite in the given file. The images
+/// and the counters have to match; the times, too, if checkTimes is set.
+/// Returns true if all cases pass.
+bool runRegression(const char* suiteFile, RegressMode mode, bool checkTimes);
+
+#endif // __REGRESS_H__
@@ -0,0 +1,211 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2012 by Veselin Georgiev, Slavomir Kaslev et al    *
+ *   admin@raytracing-bg.net                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "reproject.h"
+#include "context.h"
+#include "denoise.h"
+#include "geometry.h"
+#include "shading.h"
+#include "threads.h"
+#include "sampler.h"
+#include "stats.h"
+#include "sdl.h"
+using std::vector;
+
+extern Color raytrace(Ray ray);
+extern bool needsAA(const Color* p, int stride, int x, int y);
+
+/// the states of the pixels of the next frame
+enum {
+	PIXEL_REUSED, //!< the color of a cached pixel was reprojected there
+	PIXEL_QUEUED, //!< to be traced
+	PIXEL_TRACED //!< traced and shaded anew
+};
+
+void ReprojectionCache::resize(int w, int h)
+{
+	width = w;
+	height = h;
+	color.resize(w * h);
+	point.resize(w * h);
+	node.resize(w * h);
+	nextColor.resize(w * h);
+	nextPoint.resize(w * h);
+	nextNode.resize(w * h);
+	nextDepth.resize(w * h);
+	source.resize(w * h);
+	state.resize(w * h);
+}
+
+void ReprojectionCache::store(const AuxBuffers& aux)
+{
+	const RenderContext& rc = *currentContext;
+	resize(rc.width, rc.height);
+	camera = rc.camera;
+	sceneGeneration = rc.sceneGeneration;
+	lightPos = rc.lightPos;
+	for (int y = 0; y < height; y++)
+		for (int x = 0; x < width; x++) {
+			int i = y * width + x;
+			color[i] = rc.vfb[y][x];
+			node[i] = aux.node[i];
+			if (node[i]) {
+				Ray ray = camera.getScreenRay(x, y);
+				point[i] = ray.start + ray.dir * aux.depth[i];
+			}
+		}
+	valid = true;
+}
+
+bool ReprojectionCache::isValid(void) const
+{
+	const RenderContext& rc = *currentContext;
+	return valid && rc.width == width && rc.height == height && rc.sceneGeneration == sceneGeneration &&
+	       rc.lightPos.x == lightPos.x && rc.lightPos.y == lightPos.y && rc.lightPos.z == lightPos.z;
+}
+
+/// projects the points of the cached pixels onto the pixels of the new frame (nearest to the
+/// camera wins), and queues the pixels, where nothing landed
+static void reproject(ReprojectionCache& c)
+{
+	const Camera& camera = currentContext->camera;
+	int W = c.width, H = c.height;
+	for (int i = 0; i < W * H; i++) {
+		c.source[i] = -1;
+		c.nextDepth[i] = INF;
+	}
+	for (int k = 0; k < W * H; k++) {
+		if (!c.node[k]) continue;
+		double px, py;
+		if (!camera.project(c.point[k], px, py)) continue;
+		int x = (int) floor(px + 0.5), y = (int) floor(py + 0.5);
+		if (x < 0 || x >= W || y < 0 || y >= H) continue;
+		int i = y * W + x;
+		double d = (c.point[k] - camera.pos).length();
+		if (d < c.nextDepth[i]) {
+			c.nextDepth[i] = d;
+			c.source[i] = k;
+		}
+	}
+	c.queue.clear();
+	for (int i = 0; i < W * H; i++) {
+		int k = c.source[i];
+		if (k == -1) {
+			c.state[i] = PIXEL_QUEUED;
+			c.queue.push_back(i);
+		} else {
+			c.state[i] = PIXEL_REUSED;
+			c.nextColor[i] = c.color[k];
+			c.nextPoint[i] = c.point[k];
+			c.nextNode[i] = c.node[k];
+		}
+	}
+}
+
+/// traces and shades the queued pixels, as a parallelFor() kernel over the queue
+static void kernelTraceQueued(int begin, int end, void* data)
+{
+	RenderContext& rc = *currentContext;
+	ReprojectionCache& c = *(ReprojectionCache*) data;
+	for (int q = begin; q < end; q++) {
+		int i = c.queue[q];
+		Ray ray = rc.camera.getScreenRay(i % c.width, i / c.width);
+		IntersectionInfo info;
+		Node* node = rc.bvh.intersect(ray, info);
+		c.nextNode[i] = node;
+		c.state[i] = PIXEL_TRACED;
+		if (node) {
+			c.nextColor[i] = node->shader->shade(ray, info);
+			c.nextPoint[i] = info.ip;
+			c.nextDepth[i] = info.distance;
+		} else {
+			c.nextColor[i] = Color(0, 0, 0);
+			c.nextDepth[i] = INF;
+		}
+	}
+}
+
+/// queues the reused neighbours of the just traced pixels, which show another surface, behind the traced one
+static void queueHiddenNeighbours(ReprojectionCache& c)
+{
+	int W = c.width, H = c.height;
+	std::vector<int> traced;
+	traced.swap(c.queue);
+	for (int q = 0; q < (int) traced.size(); q++) {
+		int i = traced[q], x = i % W, y = i / W;
+		int neighbours[4] = { x > 0 ? i - 1 : -1, x < W - 1 ? i + 1 : -1, y > 0 ? i - W : -1, y < H - 1 ? i + W : -1 };
+		for (int n = 0; n < 4; n++) {
+			int j = neighbours[n];
+			if (j == -1 || c.state[j] != PIXEL_REUSED) continue;
+			if (c.nextNode[j] != c.nextNode[i] && c.nextDepth[i] < c.nextDepth[j]) {
+				c.state[j] = PIXEL_QUEUED;
+				c.queue.push_back(j);
+			}
+		}
+	}
+}
+
+/// writes the rows [begin..end) of the new frame to the vfb, anti-aliasing the shaded pixels,
+/// which need it (exactly like renderTile() does)
+static void kernelResolve(int begin, int end, void* data)
+{
+	RenderContext& rc = *currentContext;
+	ReprojectionCache& c = *(ReprojectionCache*) data;
+	int W = c.width;
+	for (int y = begin; y < end; y++) {
+		for (int x = 0; x < W; x++) {
+			int i = y * W + x;
+			if (c.state[i] == PIXEL_TRACED && needsAA(&c.nextColor[i], W, x, y)) {
+				Color accum = Color(0, 0, 0);
+				for (int samples = 0; samples < AA_SAMPLES; samples++) {
+					double dx, dy;
+					getPixelSample(x, y, samples, AA_SAMPLES, dx, dy);
+					accum += raytrace(rc.camera.getScreenRay(x + dx, y + dy));
+				}
+				rc.vfb[y][x] = accum / AA_SAMPLES;
+			} else rc.vfb[y][x] = c.nextColor[i];
+		}
+	}
+}
+
+double renderReprojected(ReprojectionCache& cache)
+{
+	RenderContext& rc = *currentContext;
+	int W = cache.width, H = cache.height;
+	reproject(cache);
+	while (!cache.queue.empty()) {
+		parallelFor((int) cache.queue.size(), 64, kernelTraceQueued, &cache);
+		queueHiddenNeighbours(cache);
+	}
+	parallelFor(H, 4, kernelResolve, &cache);
+	// the new frame becomes the cached one:
+	int reused = 0;
+	for (int y = 0; y < H; y++)
+		for (int x = 0; x < W; x++) {
+			int i = y * W + x;
+			cache.nextColor[i] = rc.vfb[y][x];
+			if (cache.state[i] == PIXEL_REUSED) reused++;
+		}
+	cache.color.swap(cache.nextColor);
+	cache.point.swap(cache.nextPoint);
+	cache.node.swap(cache.nextNode);
+	cache.camera = rc.camera;
+	return reused / (double) (W * H);
+}
@@ -0,0 +1,76 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2012 by Veselin Georgiev, Slavomir Kaslev et al    *
+ *   admin@raytracing-bg.net                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#ifndef __REPROJECT_H__
+#define __REPROJECT_H__
+
+#include <vector>
+#include "color.h"
+#include "vector.h"
+#include "camera.h"
+
+class Node;
+struct AuxBuffers;
+
+/// A temporal cache of a context's last full-resolution frame: for every pixel, its color and the
+/// surface point and node, that color was shaded for (the primary hit at the pixel's center).
+/// renderReprojected() uses it to render the next frame from a nearby camera.
+struct ReprojectionCache {
+	int width, height;
+	Camera camera; //!< the camera of the cached frame
+	int sceneGeneration;
+	Vector lightPos;
+	bool valid;
+	std::vector<Color> color;
+	std::vector<Vector> point;
+	std::vector<const Node*> node; //!< NULL where the primary ray missed
+	// the frame under construction, swapped with the above when it's done:
+	std::vector<Color> nextColor;
+	std::vector<Vector> nextPoint;
+	std::vector<const Node*> nextNode;
+	std::vector<double> nextDepth; //!< the distance from the new camera to nextPoint (INF for misses and holes)
+	std::vector<int> source; //!< the cached pixel, reprojected onto the new one (-1 if none)
+	std::vector<unsigned char> state; //!< per pixel of the next frame: PIXEL_REUSED, PIXEL_QUEUED or PIXEL_TRACED
+	std::vector<int> queue; //!< the pixels to be traced next
+	
+	ReprojectionCache() { width = height = 0; valid = false; }
+	void resize(int w, int h);
+	
+	/// caches the current context's frame, rendered with its current camera, whose primary hits were
+	/// recorded in aux (e.g., with auxBuffers set during renderContext())
+	void store(const AuxBuffers& aux);
+	void invalidate(void) { valid = false; }
+	/// checks if the cache may be used for the current context's next frame: it must be of the same
+	/// size, scene and light (only the camera may change)
+	bool isValid(void) const;
+};
+
+/// renders the current context's frame, reusing the cache (which must be valid for the context).
+/// The points of the cached pixels are projected through the new camera, onto the nearest pixels;
+/// if several land on the same pixel, the nearest to the camera wins, and the pixel takes its color.
+/// Only the pixels, where nothing lands (disocclusions, the newly exposed parts of the frame) are
+/// traced and shaded. When such a pixel finds a surface, closer than the (different) one, reprojected
+/// onto a neighbour, the neighbour is traced too, and so on: this uncovers the objects, which weren't
+/// in the cached frame, but now hide reprojected points. The traced pixels are anti-aliased where it's
+/// needed. The new frame replaces the cached one; the reused pixels keep the point, their color was
+/// shaded for, so the error stays below a pixel's offset over successive frames.
+/// Returns the fraction of the pixels, whose colors were reused.
+double renderReprojected(ReprojectionCache& cache);
+
+#endif // __REPROJECT_H__
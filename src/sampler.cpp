@@ -0,0 +1,217 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2012 by Veselin Georgiev, Slavomir Kaslev et al    *
+ *   admin@raytracing-bg.net                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include "sampler.h"
+#include "random.h"
+#include "context.h"
+using std::vector;
+
+static const char* samplerNames[SAMPLER_COUNT] = { "stratified", "halton", "sobol", "bluenoise" };
+
+const int MASK_SIZE = 64; //!< the blue-noise mask is MASK_SIZE x MASK_SIZE pixels, tiled over the frame
+static float blueNoise[MASK_SIZE][MASK_SIZE]; //!< values in (0..1)
+static bool blueNoiseReady = false;
+
+/// returns a well-mixed hash of a pixel and a "purpose" tag
+static inline unsigned pixelHash(int x, int y, unsigned tag)
+{
+	Random rnd((((unsigned long long) (unsigned) y) << 32 | (unsigned) x) ^ ((unsigned long long) tag << 20));
+	return rnd.next();
+}
+
+static inline double toUnit(unsigned x) { return x * (1.0 / 4294967296.0); }
+
+static double radicalInverse(unsigned i, unsigned base)
+{
+	double inv = 1.0 / base, mult = inv, result = 0;
+	for (; i; i /= base, mult *= inv) result += (i % base) * mult;
+	return result;
+}
+
+/// the first Sobol dimension (the van der Corput sequence) as a 32-bit fraction
+static inline unsigned sobol0(unsigned i)
+{
+	unsigned r = 0;
+	for (unsigned v = 1u << 31; i; i >>= 1, v >>= 1) if (i & 1) r ^= v;
+	return r;
+}
+
+/// the second Sobol dimension (primitive polynomial x + 1) as a 32-bit fraction
+static inline unsigned sobol1(unsigned i)
+{
+	unsigned r = 0;
+	for (unsigned v = 1u << 31; i; i >>= 1, v ^= v >> 1) if (i & 1) r ^= v;
+	return r;
+}
+
+/// adds (sign = +1) or removes (-1) the filtered contribution of the point p to the energy of all pixels
+static void splat(vector<float>& energy, const vector<float>& kernel, int p, float sign)
+{
+	int px = p % MASK_SIZE, py = p / MASK_SIZE;
+	for (int y = 0; y < MASK_SIZE; y++) {
+		const float* krow = &kernel[((y - py + MASK_SIZE) % MASK_SIZE) * MASK_SIZE];
+		float* erow = &energy[y * MASK_SIZE];
+		for (int x = 0; x < MASK_SIZE; x++)
+			erow[x] += sign * krow[(x - px + MASK_SIZE) % MASK_SIZE];
+	}
+}
+
+/// generates a MASK_SIZE x MASK_SIZE blue-noise mask by the void-and-cluster method (Ulichney, 1993):
+/// points are ranked by repeatedly taking the tightest cluster out of (or filling the largest void
+/// in) a point set, where "tight" means high energy under a toroidal Gaussian filter. The mask
+/// value of a pixel is its rank.
+static void generateBlueNoise(void)
+{
+	const int N = MASK_SIZE * MASK_SIZE;
+	const double SIGMA = 1.5;
+	// the filter, indexed by the toroidal offset:
+	vector<float> kernel(N);
+	for (int dy = 0; dy < MASK_SIZE; dy++)
+		for (int dx = 0; dx < MASK_SIZE; dx++) {
+			int ox = dx < MASK_SIZE / 2 ? dx : dx - MASK_SIZE;
+			int oy = dy < MASK_SIZE / 2 ? dy : dy - MASK_SIZE;
+			kernel[dy * MASK_SIZE + dx] = (float) exp(-(ox * ox + oy * oy) / (2 * SIGMA * SIGMA));
+		}
+	vector<unsigned char> points(N, 0);
+	vector<float> energy(N, 0.0f);
+	vector<int> rank(N, 0);
+	// the initial pattern: 10% of the pixels, random...
+	Random rnd(12345);
+	int initial = N / 10;
+	for (int placed = 0; placed < initial; ) {
+		int p = rnd.next() % N;
+		if (points[p]) continue;
+		points[p] = 1;
+		splat(energy, kernel, p, +1);
+		placed++;
+	}
+	// ... then evened out, by moving the tightest cluster to the largest void, until that's the same pixel:
+	while (1) {
+		int cluster = -1, vd = -1;
+		for (int i = 0; i < N; i++) {
+			if (points[i] && (cluster == -1 || energy[i] > energy[cluster])) cluster = i;
+		}
+		points[cluster] = 0;
+		splat(energy, kernel, cluster, -1);
+		for (int i = 0; i < N; i++) {
+			if (!points[i] && (vd == -1 || energy[i] < energy[vd])) vd = i;
+		}
+		points[vd] = 1;
+		splat(energy, kernel, vd, +1);
+		if (vd == cluster) break;
+	}
+	// phase 1: rank the initial points, removing the tightest cluster each time:
+	vector<unsigned char> initialPoints = points;
+	vector<float> initialEnergy = energy;
+	for (int r = initial - 1; r >= 0; r--) {
+		int cluster = -1;
+		for (int i = 0; i < N; i++)
+			if (points[i] && (cluster == -1 || energy[i] > energy[cluster])) cluster = i;
+		points[cluster] = 0;
+		splat(energy, kernel, cluster, -1);
+		rank[cluster] = r;
+	}
+	// phases 2 and 3: fill the largest void each time, until all pixels are ranked:
+	points = initialPoints;
+	energy = initialEnergy;
+	for (int r = initial; r < N; r++) {
+		int vd = -1;
+		for (int i = 0; i < N; i++)
+			if (!points[i] && (vd == -1 || energy[i] < energy[vd])) vd = i;
+		points[vd] = 1;
+		splat(energy, kernel, vd, +1);
+		rank[vd] = r;
+	}
+	for (int i = 0; i < N; i++)
+		blueNoise[i / MASK_SIZE][i % MASK_SIZE] = (rank[i] + 0.5f) / N;
+	blueNoiseReady = true;
+}
+
+bool setSampler(const char* name)
+{
+	for (int i = 0; i < SAMPLER_COUNT; i++)
+		if (!strcmp(name, samplerNames[i])) {
+			currentContext->sampler = (SamplerType) i;
+			if (i == SAMPLER_BLUE_NOISE && !blueNoiseReady) generateBlueNoise();
+			return true;
+		}
+	return false;
+}
+
+const char* samplerName(void)
+{
+	return samplerNames[currentContext->sampler];
+}
+
+void getPixelSample(int x, int y, int index, int count, double& dx, double& dy)
+{
+	switch (currentContext->sampler) {
+		case SAMPLER_STRATIFIED:
+		{
+			unsigned h = pixelHash(x, y, index + 1);
+			if (count <= 0) { // no grid to stratify over:
+				dx = toUnit(h);
+				dy = toUnit(pixelHash(x, y, ~index));
+				break;
+			}
+			int sx = (int) sqrt((double) count);
+			int sy = (count + sx - 1) / sx;
+			// if there are more cells than samples, rotate the used ones per pixel:
+			int cell = (index + pixelHash(x, y, 0)) % (sx * sy);
+			dx = (cell % sx + toUnit(h)) / sx;
+			dy = (cell / sx + toUnit(pixelHash(x, y, ~index))) / sy;
+			break;
+		}
+		case SAMPLER_HALTON:
+		{
+			// Cranley-Patterson rotation:
+			dx = radicalInverse(index + 1, 2) + toUnit(pixelHash(x, y, 1));
+			dy = radicalInverse(index + 1, 3) + toUnit(pixelHash(x, y, 2));
+			if (dx >= 1) dx -= 1;
+			if (dy >= 1) dy -= 1;
+			break;
+		}
+		case SAMPLER_SOBOL:
+		{
+			// XOR-ing with a per-pixel constant keeps the stratification of the sequence:
+			dx = toUnit(sobol0(index) ^ pixelHash(x, y, 1));
+			dy = toUnit(sobol1(index) ^ pixelHash(x, y, 2));
+			break;
+		}
+		case SAMPLER_BLUE_NOISE:
+		{
+			// two decorrelated mask values for the two dimensions:
+			double u = blueNoise[y % MASK_SIZE][x % MASK_SIZE];
+			double v = blueNoise[(y + MASK_SIZE / 2) % MASK_SIZE][(x + MASK_SIZE / 3) % MASK_SIZE];
+			// the R2 sequence (the generalized golden ratio):
+			dx = u + index * 0.7548776662466927;
+			dy = v + index * 0.5698402909980532;
+			dx -= floor(dx);
+			dy -= floor(dy);
+			break;
+		}
+		default:
+			dx = dy = 0.5;
+			break;
+	}
+}
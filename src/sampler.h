@@ -0,0 +1,46 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2012 by Veselin Georgiev, Slavomir Kaslev et al    *
+ *   admin@raytracing-bg.net                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#ifndef __SAMPLER_H__
+#define __SAMPLER_H__
+
+/// The patterns of sub-pixel sample positions, shared by all renderers (anti-aliasing, supersampling,
+/// path tracing). All of them are decorrelated per pixel (so there's no structured aliasing, repeating
+/// from pixel to pixel), and are pure functions of the pixel and the sample index (so the image doesn't
+/// depend on the thread count, or on the order in which pixels are rendered).
+enum SamplerType {
+	SAMPLER_STRATIFIED, //!< jittered grid cells; the unused cells (if count isn't a product of two close numbers) change per pixel
+	SAMPLER_HALTON, //!< the Halton sequence (bases 2 and 3), toroidally shifted per pixel
+	SAMPLER_SOBOL, //!< the first two Sobol dimensions (a (0,2)-sequence), randomly digit-scrambled per pixel
+	SAMPLER_BLUE_NOISE, //!< the R2 sequence, shifted per pixel by a blue-noise mask, so the error in neighbouring pixels differs
+	SAMPLER_COUNT
+};
+
+/// selects the sampler ("stratified", "halton", "sobol" or "bluenoise") of the current context (see
+/// context.h; the default is Sobol). Returns false for anything else. Must be called before rendering,
+/// as it may need to precompute tables.
+bool setSampler(const char* name);
+const char* samplerName(void); //!< the name of the current context's sampler
+
+/// returns the position of sample `index' (of `count') in pixel (x, y), as offsets in [0..1) from the pixel's
+/// corner. A count of 0 means "unknown" (e.g. progressive rendering); the samples are then as good
+/// as the sampler allows, without knowing how many more will follow.
+void getPixelSample(int x, int y, int index, int count, double& dx, double& dy);
+
+#endif // __SAMPLER_H__
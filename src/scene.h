@@ -0,0 +1,52 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2012 by Veselin Georgiev, Slavomir Kaslev et al    *
+ *   admin@raytracing-bg.net                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#ifndef __SCENE_H__
+#define __SCENE_H__
+
+#include <vector>
+#include "arena.h"
+
+class Geometry;
+class Shader;
+class Texture;
+class Node;
+
+/// All objects of the scene. They are allocated in the arena (`new (scene.arena) Sphere(...)'),
+/// so there's no limit on their count, they're laid out compactly, and clear() frees them at once.
+/// The lists must not change while the scene is rendered (the BVH points into `nodes').
+struct Scene {
+	Arena arena;
+	std::vector<Geometry*> geometries;
+	std::vector<Shader*> shaders;
+	std::vector<Node*> nodes;
+	std::vector<Texture*> textures;
+	
+	void clear(void)
+	{
+		geometries.clear();
+		shaders.clear();
+		nodes.clear();
+		textures.clear();
+		arena.clear();
+	}
+};
+
+
+#endif // __SCENE_H__
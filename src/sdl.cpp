@@ -20,11 +20,13 @@
 #include <SDL/SDL.h>
 #include <stdio.h>
 #include "sdl.h"
+#include "output.h"
+#include "context.h"
 
 
 SDL_Surface* screen = NULL;
 
-/// try to create a frame window with the given dimensions
+/// try to create a frame window with the given dimensions (the current context's frame is resized to match)
 bool initGraphics(int frameWidth, int frameHeight)
 {
 	if (SDL_Init(SDL_INIT_VIDEO) < 0) {
@@ -36,6 +38,19 @@ bool initGraphics(int frameWidth, int frameHeight)
 		printf("Cannot set video mode %dx%d - %s\n", frameWidth, frameHeight, SDL_GetError());
 		return false;
 	}
+	currentContext->resize(frameWidth, frameHeight);
+	return true;
+}
+
+/// prepares the current context for rendering a frame with the given dimensions, without a
+/// window (e.g., when the result is only saved to a file, or sent over the network)
+bool initHeadless(int frameWidth, int frameHeight)
+{
+	if (SDL_Init(SDL_INIT_TIMER) < 0) {
+		printf("Cannot initialize SDL: %s\n", SDL_GetError());
+		return false;
+	}
+	currentContext->resize(frameWidth, frameHeight);
 	return true;
 }
 
@@ -45,37 +60,49 @@ void closeGraphics(void)
 	SDL_Quit();
 }
 
-/// displays a VFB (virtual frame buffer) to the real framebuffer, with the necessary color clipping
-void displayVFB(Color vfb[VFB_MAX_SIZE][VFB_MAX_SIZE])
+/// displays a VFB (virtual frame buffer) to the real framebuffer, with the necessary color clipping.
+/// The VFB isn't changed.
+void displayVFB(const Color vfb[VFB_MAX_SIZE][VFB_MAX_SIZE])
 {
 	int rs = screen->format->Rshift;
 	int gs = screen->format->Gshift;
 	int bs = screen->format->Bshift;
-	for (int y = 0; y < screen->h; y++) {
-		Uint32 *row = (Uint32*) ((Uint8*) screen->pixels + y * screen->pitch);
-		for (int x = 0; x < screen->w; x++){
-//			row[x] = vfb[y][x].toRGB32(rs, gs, bs);
-		}
-	}
-
-	for (int y = 0; y < screen->h; y++) {
-		Uint32 *row = (Uint32*) ((Uint8*) screen->pixels + y * screen->pitch);
-		for (int x = 0; x < screen->w; x++){
-//			Color old_pixel = vfb[y][x];
-//			vfb[y][x+1]+=(7.0f/16)*old_pixel;
-//			vfb[y+1][x+1]+=(1.0f/16)*old_pixel;
-//			vfb[y+1][x-1]+=(3.0f/16)*old_pixel;
-//			vfb[y+1][x]+=(5.0/16)*old_pixel;
-//			row[x] = vfb[y][x].toRGB32(rs, gs, bs);
+	quantizeFrame(vfb, screen->w, screen->h, (unsigned*) screen->pixels, screen->pitch / 4, rs, gs, bs);
+	SDL_Flip(screen);
+}
 
-			row[x] = vfb[y][x].toRGB32(vfb,x,y);
-		}
+/// handles the keys, which change the output stage of the current context: +/- change the exposure,
+/// G toggles gamma 2.2 and T cycles the tone mapping. The retained frame is then re-exposed and displayed.
+/// Returns false if the key isn't one of these.
+bool handleOutputKey(int key)
+{
+	PostProcess& postProcess = currentContext->postProcess;
+	switch (key) {
+		case SDLK_EQUALS:
+		case SDLK_PLUS:
+		case SDLK_KP_PLUS:
+			postProcess.exposure += 0.5f;
+			break;
+		case SDLK_MINUS:
+		case SDLK_KP_MINUS:
+			postProcess.exposure -= 0.5f;
+			break;
+		case SDLK_g:
+			postProcess.gamma = postProcess.gamma == 1 ? 2.2f : 1;
+			break;
+		case SDLK_t:
+			postProcess.curve = (ToneMapCurve) ((postProcess.curve + 1) % 3);
+			break;
+		default:
+			return false;
 	}
-	SDL_Flip(screen);
+	postProcess.print();
+	displayVFB(currentContext->vfb);
+	return true;
 }
 
 /// waits the user to indicate he wants to close the application (by either clicking on the "X" of the window,
-/// or by pressing ESC)
+/// or by pressing ESC). Meanwhile, the output stage keys work (see handleOutputKey()).
 void waitForUserExit(void)
 {
 	SDL_Event ev;
@@ -85,14 +112,9 @@ void waitForUserExit(void)
 				case SDL_QUIT:
 					return;
 				case SDL_KEYDOWN:
-				{
-					switch (ev.key.keysym.sym) {
-						case SDLK_ESCAPE:
-							return;
-						default:
-							break;
-					}
-				}
+					if (ev.key.keysym.sym == SDLK_ESCAPE) return;
+					handleOutputKey(ev.key.keysym.sym);
+					break;
 				case SDL_MOUSEBUTTONUP:
 				{
 					extern void handleMouse(SDL_MouseButtonEvent *mev);
@@ -106,16 +128,25 @@ void waitForUserExit(void)
 	}
 }
 
-/// returns the frame width
+/// checks (without waiting) whether the user closed the window or pressed ESC
+bool userWantsToQuit(void)
+{
+	SDL_Event ev;
+	while (SDL_PollEvent(&ev)) {
+		if (ev.type == SDL_QUIT) return true;
+		if (ev.type == SDL_KEYDOWN && ev.key.keysym.sym == SDLK_ESCAPE) return true;
+	}
+	return false;
+}
+
+/// returns the frame width of the current context
 int frameWidth(void)
 {
-	if (screen) return screen->w;
-	return 0;
+	return currentContext->width;
 }
 
-/// returns the frame height
+/// returns the frame height of the current context
 int frameHeight(void)
 {
-	if (screen) return screen->h;
-	return 0;
+	return currentContext->height;
 }
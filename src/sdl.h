@@ -24,10 +24,13 @@
 #include "constants.h"
 
 bool initGraphics(int frameWidth, int frameHeight);
+bool initHeadless(int frameWidth, int frameHeight); //!< like initGraphics(), but without opening a window
 void closeGraphics(void);
-void displayVFB(Color vfb[VFB_MAX_SIZE][VFB_MAX_SIZE]); //!< displays the VFB (Virtual framebuffer) to the real one.
+void displayVFB(const Color vfb[VFB_MAX_SIZE][VFB_MAX_SIZE]); //!< displays the VFB (Virtual framebuffer) to the real one.
 void waitForUserExit(void); //!< Pause. Wait until the user closes the application
-int frameWidth(void); //!< returns the frame width (pixels)
-int frameHeight(void); //!< returns the frame height (pixels)
+bool userWantsToQuit(void); //!< returns true if the user has closed the window or pressed ESC (doesn't wait)
+bool handleOutputKey(int key); //!< applies an output-stage key (+/-, G, T) and redisplays; false for other keys
+int frameWidth(void); //!< returns the frame width of the current context (pixels)
+int frameHeight(void); //!< returns the frame height of the current context (pixels)
 
 #endif // __SDL_H__
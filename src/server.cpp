@@ -0,0 +1,448 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2012 by Veselin Georgiev, Slavomir Kaslev et al    *
+ *   admin@raytracing-bg.net                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <SDL/SDL.h>
+#include <SDL/SDL_thread.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "server.h"
+#include "camera.h"
+#include "sdl.h"
+#include "output.h"
+#include "pathtracer.h"
+#include "bitmap.h"
+#include "net.h"
+#include "context.h"
+#include "threads.h"
+using std::vector;
+
+RenderJob::RenderJob()
+{
+	sceneId = 0;
+	width = RESX;
+	height = RESY;
+	passes = 0;
+	pos.makeZero();
+	yaw = pitch = roll = fov = 0;
+}
+
+#ifdef _WIN32
+
+bool runServer(const char* address, int sceneId)
+{
+	printf("The render server is not supported on this platform\n");
+	return false;
+}
+
+bool requestRender(const char* address, const RenderJob& job, const char* outputFile)
+{
+	printf("The render server is not supported on this platform\n");
+	return false;
+}
+
+bool stopServer(const char* address)
+{
+	printf("The render server is not supported on this platform\n");
+	return false;
+}
+
+#else
+
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <arpa/inet.h>
+
+
+enum {
+	MSG_RENDER = 1,
+	MSG_IMAGE,
+	MSG_STOP
+};
+
+const unsigned SERVER_MAGIC = 0x52545331; // "RTS1"
+const int JOB_WORDS = 13; //!< the words of MSG_RENDER after the type
+const int MAX_RUNNING_JOBS = 4; //!< further jobs wait (unread) in their clients' buffers
+const Uint32 CLIENT_TIMEOUT = 10000; //!< ms; a client, which stops in the middle of a message, is dropped after that
+
+extern bool generateScene(int sceneId);
+
+/// a resident copy of a scene, in a context of its own; renders one job at a time
+struct SceneSlot {
+	int sceneId;
+	RenderContext* context;
+	Camera camera; //!< for the jobs, which don't give one
+	bool busy;
+};
+
+/// a job, which is rendered on its own thread; the thread also sends the reply
+struct JobThread {
+	RenderJob job;
+	unsigned jobId;
+	int fd; //!< the client's socket
+	SceneSlot* slot;
+	bool sent; //!< the reply went out
+	bool done; //!< guarded by jobsMutex
+	SDL_Thread* thread;
+};
+
+/// a connected client and what it sent so far
+struct Client {
+	int fd;
+	vector<unsigned char> inbox; //!< received, but not handled yet (possibly a partial message)
+	Uint32 lastReceived;
+	JobThread* job; //!< the running job of the client, if any (its jobs are rendered one at a time)
+	bool closing; //!< the connection ended (or is to be dropped), once the job is done
+};
+
+static SDL_mutex* jobsMutex = NULL;
+static int wakeupPipe[2]; //!< the job threads write a byte into it, when they finish
+
+/// renders a job into `pixels', in the current context (a scene slot's)
+static void renderJob(const RenderJob& job, const Camera& sceneCamera, vector<unsigned>& pixels)
+{
+	RenderContext& rc = *currentContext;
+	rc.resize(job.width, job.height);
+	rc.camera = sceneCamera;
+	if (job.fov > 0) {
+		rc.camera.pos = job.pos;
+		rc.camera.yaw = job.yaw;
+		rc.camera.pitch = job.pitch;
+		rc.camera.roll = job.roll;
+		rc.camera.fov = job.fov;
+	}
+	rc.camera.aspect = job.width / (double) job.height;
+	rc.camera.beginRender();
+	rc.prepareFrame();
+	if (job.passes > 0) renderProgressive(job.passes, 0, false);
+	else renderContext(rc);
+	pixels.resize(job.width * job.height);
+	quantizeFrame(rc.vfb, job.width, job.height, &pixels[0], job.width);
+}
+
+/// sends the reply to a job (the pixels only if status is JOB_OK)
+static bool sendReply(int fd, unsigned jobId, JobStatus status, const RenderJob& job, Uint32 time, vector<unsigned>& pixels)
+{
+	unsigned reply[6] = { MSG_IMAGE, jobId, (unsigned) status, (unsigned) job.width, (unsigned) job.height, time };
+	if (!sendWords(fd, reply, 6)) return false;
+	if (status != JOB_OK) return true;
+	for (int i = 0; i < (int) pixels.size(); i++) pixels[i] = htonl(pixels[i]);
+	return sendAll(fd, &pixels[0], (int) pixels.size() * sizeof(unsigned));
+}
+
+static int jobThread(void* data)
+{
+	JobThread* jt = (JobThread*) data;
+	const RenderJob& job = jt->job;
+	ContextScope scope(*jt->slot->context);
+	vector<unsigned> pixels;
+	Uint32 ticks = SDL_GetTicks();
+	renderJob(job, jt->slot->camera, pixels);
+	Uint32 time = SDL_GetTicks() - ticks;
+	printf("Job %u: %dx%d, scene %d, %s, %.3lf s\n", jt->jobId, job.width, job.height, job.sceneId,
+	       job.passes ? "path traced" : "ray traced", time / 1000.0);
+	jt->sent = sendReply(jt->fd, jt->jobId, JOB_OK, job, time, pixels);
+	
+	SDL_mutexP(jobsMutex);
+	jt->done = true;
+	SDL_mutexV(jobsMutex);
+	char c = 0;
+	while (write(wakeupPipe[1], &c, 1) < 0 && errno == EINTR);
+	return 0;
+}
+
+/// finds an idle slot with the job's scene, or makes one (with the settings of `server', the
+/// context the server was started in; its scene's camera is kept, e.g. from --camera)
+static SceneSlot* getSceneSlot(vector<SceneSlot*>& slots, int sceneId, int serverSceneId, RenderContext& server)
+{
+	for (int i = 0; i < (int) slots.size(); i++)
+		if (slots[i]->sceneId == sceneId && !slots[i]->busy) return slots[i];
+	SceneSlot* slot = new SceneSlot;
+	slot->sceneId = sceneId;
+	slot->context = new RenderContext;
+	slot->busy = false;
+	ContextScope scope(*slot->context);
+	generateScene(sceneId);
+	RenderContext& rc = *slot->context;
+	rc.sampler = server.sampler;
+	rc.postProcess = server.postProcess;
+	rc.shadowMapSize = server.shadowMapSize;
+	slot->camera = sceneId == serverSceneId ? server.camera : rc.camera;
+	slots.push_back(slot);
+	return slot;
+}
+
+/// reads a MSG_RENDER's words (after the type) from a buffer into a job; returns false if the magic is wrong
+static bool decodeJob(const vector<unsigned char>& buff, int offset, unsigned& jobId, RenderJob& job)
+{
+	unsigned w[JOB_WORDS];
+	for (int i = 0; i < JOB_WORDS; i++) w[i] = wordAt(buff, offset + 4 * i);
+	if (w[0] != SERVER_MAGIC) return false;
+	jobId = w[1];
+	job.sceneId = (int) w[2];
+	job.width = (int) w[3];
+	job.height = (int) w[4];
+	job.passes = (int) w[5];
+	job.pos = Vector(bitsFloat(w[6]), bitsFloat(w[7]), bitsFloat(w[8]));
+	job.yaw = bitsFloat(w[9]);
+	job.pitch = bitsFloat(w[10]);
+	job.roll = bitsFloat(w[11]);
+	job.fov = bitsFloat(w[12]);
+	return true;
+}
+
+/// the size of the message, which starts the inbox, or 0 if its type isn't there yet (-1: unknown type)
+static int messageSize(const vector<unsigned char>& inbox)
+{
+	if (inbox.size() < sizeof(unsigned)) return 0;
+	switch (wordAt(inbox, 0)) {
+		case MSG_RENDER: return (1 + JOB_WORDS) * sizeof(unsigned);
+		case MSG_STOP: return sizeof(unsigned);
+		default: return -1;
+	}
+}
+
+/// handles the complete messages in a client's inbox, until one of its jobs is started (or there's no
+/// room for one). Rejected jobs are answered right away. Sets `stop' if the client asked the server to
+/// shut down.
+static void handleMessages(Client& c, vector<SceneSlot*>& slots, int& running, int serverSceneId,
+                           RenderContext& server, bool& stop)
+{
+	while (!c.closing && !c.job && !stop) {
+		int size = messageSize(c.inbox);
+		if (size < 0) c.closing = true;
+		if (size <= 0 || (int) c.inbox.size() < size) return;
+		if (wordAt(c.inbox, 0) == MSG_STOP) {
+			stop = true;
+			c.closing = true;
+			return;
+		}
+		if (running >= MAX_RUNNING_JOBS) return;
+		RenderJob job;
+		unsigned jobId;
+		if (!decodeJob(c.inbox, sizeof(unsigned), jobId, job)) {
+			c.closing = true;
+			return;
+		}
+		c.inbox.erase(c.inbox.begin(), c.inbox.begin() + size);
+		JobStatus status = JOB_OK;
+		if (job.sceneId < 0 || job.sceneId >= SCENE_COUNT) status = JOB_NO_SUCH_SCENE;
+		else if (job.width <= 0 || job.height <= 0 || job.width > VFB_MAX_SIZE || job.height > VFB_MAX_SIZE)
+			status = JOB_BAD_SIZE;
+		if (status != JOB_OK) {
+			printf("Job %u: rejected (status %d)\n", jobId, (int) status);
+			vector<unsigned> none;
+			if (!sendReply(c.fd, jobId, status, job, 0, none)) c.closing = true;
+			continue;
+		}
+		JobThread* jt = new JobThread;
+		jt->job = job;
+		jt->jobId = jobId;
+		jt->fd = c.fd;
+		jt->slot = getSceneSlot(slots, job.sceneId, serverSceneId, server);
+		jt->slot->busy = true;
+		jt->sent = jt->done = false;
+		jt->thread = SDL_CreateThread(jobThread, jt);
+		c.job = jt;
+		running++;
+	}
+}
+
+bool runServer(const char* address, int sceneId)
+{
+	signal(SIGPIPE, SIG_IGN);
+	int family;
+	int listenFd = listenOn(address, family);
+	if (listenFd < 0) return false;
+	if (pipe(wakeupPipe) < 0) {
+		printf("pipe() failed: %s\n", strerror(errno));
+		closeListener(listenFd, address);
+		return false;
+	}
+	jobsMutex = SDL_CreateMutex();
+	// the job threads share the pool; it must be up before they call parallelFor():
+	initThreads();
+	RenderContext& server = *currentContext;
+	printf("Serving render jobs on %s\n", address);
+	
+	vector<Client> clients;
+	vector<SceneSlot*> slots;
+	int jobs = 0, running = 0;
+	bool stop = false, ok = true;
+	while (!stop || running > 0) {
+		fd_set fds;
+		FD_ZERO(&fds);
+		FD_SET(wakeupPipe[0], &fds);
+		int maxFd = wakeupPipe[0];
+		if (!stop) {
+			FD_SET(listenFd, &fds);
+			if (listenFd > maxFd) maxFd = listenFd;
+		}
+		for (int i = 0; i < (int) clients.size(); i++) {
+			if (clients[i].closing) continue;
+			FD_SET(clients[i].fd, &fds);
+			if (clients[i].fd > maxFd) maxFd = clients[i].fd;
+		}
+		// wake up now and then, to drop the stalled clients:
+		timeval timeout = { 1, 0 };
+		if (select(maxFd + 1, &fds, NULL, NULL, &timeout) < 0) {
+			if (errno == EINTR) continue;
+			printf("select() failed: %s\n", strerror(errno));
+			ok = false;
+			break;
+		}
+		Uint32 now = SDL_GetTicks();
+		if (!stop && FD_ISSET(listenFd, &fds)) {
+			int fd = accept(listenFd, NULL, NULL);
+			if (fd >= 0) {
+				setNoDelay(fd, family);
+				Client c;
+				c.fd = fd;
+				c.lastReceived = now;
+				c.job = NULL;
+				c.closing = false;
+				clients.push_back(c);
+			}
+		}
+		if (FD_ISSET(wakeupPipe[0], &fds)) {
+			char drain[64];
+			while (read(wakeupPipe[0], drain, sizeof(drain)) < 0 && errno == EINTR);
+		}
+		for (int i = 0; i < (int) clients.size(); i++) {
+			Client& c = clients[i];
+			// collect the finished job:
+			if (c.job) {
+				SDL_mutexP(jobsMutex);
+				bool done = c.job->done;
+				SDL_mutexV(jobsMutex);
+				if (done) {
+					SDL_WaitThread(c.job->thread, NULL);
+					c.job->slot->busy = false;
+					if (c.job->sent) jobs++;
+					else c.closing = true;
+					delete c.job;
+					c.job = NULL;
+					running--;
+				}
+			}
+			if (!c.closing && FD_ISSET(c.fd, &fds)) {
+				int n = recvAvailable(c.fd, c.inbox);
+				if (n < 0) c.closing = true;
+				else if (n > 0) c.lastReceived = now;
+			}
+		}
+		// one started job per client and round, so a client with a long queue doesn't starve the others:
+		for (int i = 0; i < (int) clients.size(); i++) {
+			Client& c = clients[i];
+			handleMessages(c, slots, running, sceneId, server, stop);
+			int size = messageSize(c.inbox);
+			bool partial = !c.inbox.empty() && (size == 0 || (int) c.inbox.size() < size);
+			if (partial && now - c.lastReceived > CLIENT_TIMEOUT) {
+				printf("Dropping a client, which stalled in the middle of a message\n");
+				c.closing = true;
+			}
+			if (c.closing && !c.job) {
+				close(c.fd);
+				clients.erase(clients.begin() + i--);
+			}
+		}
+	}
+	for (int i = 0; i < (int) clients.size(); i++) {
+		if (clients[i].job) {
+			SDL_WaitThread(clients[i].job->thread, NULL);
+			delete clients[i].job;
+		}
+		close(clients[i].fd);
+	}
+	for (int i = 0; i < (int) slots.size(); i++) {
+		delete slots[i]->context;
+		delete slots[i];
+	}
+	closeListener(listenFd, address);
+	close(wakeupPipe[0]);
+	close(wakeupPipe[1]);
+	SDL_DestroyMutex(jobsMutex);
+	printf("Render server stopped after %d job(s)\n", jobs);
+	return ok;
+}
+
+bool requestRender(const char* address, const RenderJob& job, const char* outputFile)
+{
+	signal(SIGPIPE, SIG_IGN);
+	int family;
+	int fd = connectTo(address, 1, family);
+	if (fd < 0) {
+		printf("Cannot connect to the render server at `%s'\n", address);
+		return false;
+	}
+	setNoDelay(fd, family);
+	unsigned jobId = (unsigned) getpid();
+	unsigned msg[1 + JOB_WORDS] = {
+		MSG_RENDER, SERVER_MAGIC, jobId, (unsigned) job.sceneId, (unsigned) job.width, (unsigned) job.height,
+		(unsigned) job.passes, floatBits((float) job.pos.x), floatBits((float) job.pos.y), floatBits((float) job.pos.z),
+		floatBits((float) job.yaw), floatBits((float) job.pitch), floatBits((float) job.roll), floatBits((float) job.fov)
+	};
+	unsigned reply[6];
+	if (!sendWords(fd, msg, 1 + JOB_WORDS) || !recvWords(fd, reply, 6) || reply[0] != MSG_IMAGE || reply[1] != jobId) {
+		printf("Bad reply from the render server at `%s'\n", address);
+		close(fd);
+		return false;
+	}
+	if (reply[2] != JOB_OK) {
+		printf("The render server rejected the job (status %u)\n", reply[2]);
+		close(fd);
+		return false;
+	}
+	int W = (int) reply[3], H = (int) reply[4];
+	vector<unsigned> pixels(W * H);
+	bool ok = recvAll(fd, &pixels[0], W * H * sizeof(unsigned));
+	close(fd);
+	if (!ok) {
+		printf("Connection to the render server lost\n");
+		return false;
+	}
+	for (int i = 0; i < W * H; i++) pixels[i] = ntohl(pixels[i]);
+	printf("Rendered %dx%d in %.3lf s\n", W, H, reply[5] / 1000.0);
+	if (!saveBMP(outputFile, &pixels[0], W, H)) {
+		printf("Cannot save `%s'\n", outputFile);
+		return false;
+	}
+	return true;
+}
+
+bool stopServer(const char* address)
+{
+	int family;
+	int fd = connectTo(address, 1, family);
+	if (fd < 0) {
+		printf("Cannot connect to the render server at `%s'\n", address);
+		return false;
+	}
+	unsigned msg = MSG_STOP;
+	bool ok = sendWords(fd, &msg, 1);
+	close(fd);
+	return ok;
+}
+
+#endif // _WIN32
@@ -0,0 +1,78 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2012 by Veselin Georgiev, Slavomir Kaslev et al    *
+ *   admin@raytracing-bg.net                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#ifndef __SERVER_H__
+#define __SERVER_H__
+
+#include "vector.h"
+
+/*
+ * Render server: a long-running process, which keeps the scenes it has built (geometry,
+ * textures, the BVH) in memory, and renders frames of them on request. Clients connect to
+ * a local (or TCP) socket (see net.h for the addresses) and send render jobs; each one
+ * gets back the finished image, after the output stage. So, the latency of a request is
+ * just the tracing time.
+ *
+ * Every job is rendered on a thread of its own, in a RenderContext of its own: a resident
+ * copy of the job's scene, built when the scene is first requested (or when all of its
+ * copies are busy). A few jobs (MAX_RUNNING_JOBS in server.cpp) run at the same time;
+ * their chunks share the thread pool, so a short job doesn't wait for a long one. A
+ * client's jobs are rendered one at a time, in the order they arrive. The server never
+ * waits for a client: messages are read as they arrive, and a client, which stalls in the
+ * middle of one, is dropped after a while.
+ *
+ * The protocol (32-bit words in network byte order; floats are sent as their bits):
+ *
+ * client -> server:
+ *    MSG_RENDER   magic, jobId, sceneId, width, height, passes, x, y, z, yaw, pitch, roll, fov
+ *    MSG_STOP     (shuts the server down)
+ * server -> client:
+ *    MSG_IMAGE    jobId, status, width, height, milliseconds, followed (if status is
+ *                 JOB_OK) by width*height pixels (0x00RRGGBB)
+ */
+
+enum JobStatus {
+	JOB_OK,
+	JOB_NO_SUCH_SCENE,
+	JOB_BAD_SIZE
+};
+
+struct RenderJob {
+	int sceneId; //!< the built-in scene (see generateScene())
+	int width, height;
+	int passes; //!< 0: the ray tracer (with adaptive AA); otherwise, path tracing with that many passes
+	Vector pos; //!< camera position
+	double yaw, pitch, roll, fov; //!< camera orientation; fov = 0 means "the scene's default camera"
+	
+	RenderJob();
+};
+
+/// serves render jobs on `address', until a client stops it. The current context holds scene
+/// sceneId; its render settings (and, for that scene, its camera) are the jobs' defaults.
+/// Returns false on errors.
+bool runServer(const char* address, int sceneId);
+
+/// sends a job to the server at `address', and saves the resulting image to `outputFile' (BMP).
+/// Returns false on errors.
+bool requestRender(const char* address, const RenderJob& job, const char* outputFile);
+
+/// asks the server at `address' to shut down
+bool stopServer(const char* address);
+
+#endif // __SERVER_H__
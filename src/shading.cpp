@@ -20,14 +20,12 @@
 
 #include "shading.h"
 #include "bitmap.h"
+#include "raydebug.h"
+#include "context.h"
 #include <math.h>
 #include <stdio.h>
 
-Vector lightPos;
-Color ambient = Color(0.1f, 0.1f, 0.1f);
-Color lightIntensity;
-
-Color Checker::getTexColor(const IntersectionInfo& info)
+inline Color Checker::sample(double u, double v) const
 {
 	/*
 	 * The checker texture works like that. Partition the whole 2D space
@@ -35,30 +33,71 @@ Color Checker::getTexColor(const IntersectionInfo& info)
 	 * integral coordinates of the square, which our point happens to be. Then,
 	 * use the parity of the sum of those coordinates to decide which color to return.
 	 */
-	int squareX = (int) floor(info.u / squareSize);
-	int squareY = (int) floor(info.v / squareSize);
+	int squareX = (int) floor(u / squareSize);
+	int squareY = (int) floor(v / squareSize);
 	if ((squareX + squareY) % 2 == 0) return col1;
 	else return col2;
 }
 
+Color Checker::getTexColor(const IntersectionInfo& info)
+{
+	return sample(info.u, info.v);
+}
+
+void Checker::getTexColors(const IntersectionInfo* infos, Color* out, int n)
+{
+	for (int i = 0; i < n; i++) out[i] = sample(infos[i].u, infos[i].v);
+}
+
 bool lightIsVisible(Vector p, Vector l);
 
 Color Lambert::shade(const Ray& ray, const IntersectionInfo& info)
+{
+	// check if our point (info.ip) is visible from the light:
+	return shadeWithVisibility(ray, info, lightIsVisible(info.ip, currentContext->lightPos));
+}
+
+inline Color Lambert::getMaterialColor(const IntersectionInfo& info) const
 {
 	// fetch the material color. This is ether the solid color, or a color
 	// from the texture, if it's set up.
-	Color materialColor;
-	if (texture != NULL) materialColor = texture->getTexColor(info);
-	else materialColor = color;
-	
-	// check if our point (info.ip) is visible from the light:
-	
-	Vector lightDir = lightPos - info.ip;
+	if (texture != NULL) return texture->getTexColor(info);
+	else return color;
+}
+
+Color Lambert::shadeWithVisibility(const Ray& ray, const IntersectionInfo& info, bool lightVisible)
+{
+	return illuminate(getMaterialColor(info), ray, info, lightVisible, currentContext->ambient);
+}
+
+Color Lambert::getAlbedo(const IntersectionInfo& info)
+{
+	return getMaterialColor(info);
+}
+
+Color Lambert::shadeDirect(const Ray& ray, const IntersectionInfo& info, bool lightVisible)
+{
+	return illuminate(getMaterialColor(info), ray, info, lightVisible, Color(0, 0, 0));
+}
+
+void Lambert::shadeBatch(const Ray* rays, const IntersectionInfo* infos, const unsigned char* lightVisible, Color* out, int n)
+{
+	// fetch all material colors first, then light them:
+	if (texture != NULL) texture->getTexColors(infos, out, n);
+	else for (int i = 0; i < n; i++) out[i] = color;
+	const Color& ambient = currentContext->ambient;
+	for (int i = 0; i < n; i++) out[i] = illuminate(out[i], rays[i], infos[i], lightVisible[i] != 0, ambient);
+}
+
+inline Color Lambert::illuminate(const Color& materialColor, const Ray& ray, const IntersectionInfo& info, bool lightVisible, const Color& ambientLight) const
+{
+	const RenderContext& rc = *currentContext;
+	Vector lightDir = rc.lightPos - info.ip;
 	
 	double lightDist = lightDir.length();
-	Color lightMultiplier = ambient;
-	if (lightIsVisible(info.ip, lightPos)) {
-		lightMultiplier += lightIntensity / float(sqr(lightDist));
+	Color lightMultiplier = ambientLight;
+	if (lightVisible) {
+		lightMultiplier += rc.lightIntensity / float(sqr(lightDist));
 	}
 	
 	lightDir.normalize();
@@ -67,26 +106,65 @@ Color Lambert::shade(const Ray& ray, const IntersectionInfo& info)
 	double normDotL = lightDir * info.norm;
 	if (normDotL < 0) normDotL = 0; // light can be "below" the surface.
 	// multiply all that together and apply the quadratic light attenuation law.
-	return materialColor * lightMultiplier * (float) (normDotL);
+	Color result = materialColor * lightMultiplier * (float) (normDotL);
+	RAY_TREE(begin("shading"));
+	RAY_TREE(field("shader", "Lambert"));
+	RAY_TREE(field("material", materialColor));
+	RAY_TREE(field("lightVisible", lightVisible));
+	RAY_TREE(field("lightMultiplier", lightMultiplier));
+	RAY_TREE(field("normDotL", normDotL));
+	RAY_TREE(field("result", result));
+	RAY_TREE(end());
+	return result;
 }
 
 Color Phong::shade(const Ray& ray, const IntersectionInfo& info)
+{
+	return shadeWithVisibility(ray, info, lightIsVisible(info.ip, currentContext->lightPos));
+}
+
+inline Color Phong::getMaterialColor(const IntersectionInfo& info) const
 {
 	// fetch the material color. This is ether the solid color, or a color
 	// from the texture, if it's set up.
-	Color materialColor;
-	if (texture != NULL) materialColor = texture->getTexColor(info);
-	else materialColor = color;
-	
-	bool lightVisible = lightIsVisible(info.ip, lightPos);
+	if (texture != NULL) return texture->getTexColor(info);
+	else return color;
+}
+
+Color Phong::shadeWithVisibility(const Ray& ray, const IntersectionInfo& info, bool lightVisible)
+{
+	return illuminate(getMaterialColor(info), ray, info, lightVisible, currentContext->ambient);
+}
+
+Color Phong::getAlbedo(const IntersectionInfo& info)
+{
+	return getMaterialColor(info);
+}
+
+Color Phong::shadeDirect(const Ray& ray, const IntersectionInfo& info, bool lightVisible)
+{
+	return illuminate(getMaterialColor(info), ray, info, lightVisible, Color(0, 0, 0));
+}
+
+void Phong::shadeBatch(const Ray* rays, const IntersectionInfo* infos, const unsigned char* lightVisible, Color* out, int n)
+{
+	if (texture != NULL) texture->getTexColors(infos, out, n);
+	else for (int i = 0; i < n; i++) out[i] = color;
+	const Color& ambient = currentContext->ambient;
+	for (int i = 0; i < n; i++) out[i] = illuminate(out[i], rays[i], infos[i], lightVisible[i] != 0, ambient);
+}
+
+inline Color Phong::illuminate(const Color& materialColor, const Ray& ray, const IntersectionInfo& info, bool lightVisible, const Color& ambientLight) const
+{
+	const RenderContext& rc = *currentContext;
 	Vector nrm = faceforward(info.norm, ray.dir);
 	
-	Vector lightDir = lightPos - info.ip;
+	Vector lightDir = rc.lightPos - info.ip;
 	
 	double lightDist = lightDir.length();
-	Color lightMultiplier = ambient;
+	Color lightMultiplier = ambientLight;
 	if (lightVisible) {
-		lightMultiplier += lightIntensity / float(sqr(lightDist));
+		lightMultiplier += rc.lightIntensity / float(sqr(lightDist));
 	}
 
 	lightDir.normalize();
@@ -96,18 +174,31 @@ Color Phong::shade(const Ray& ray, const IntersectionInfo& info)
 	if (normDotL < 0) normDotL = 0; // light can be "below" the surface.
 	// multiply all that together and apply the quadratic light attenuation law.
 	Color lambertResult = materialColor * lightMultiplier * (float) (normDotL);
+	RAY_TREE(begin("shading"));
+	RAY_TREE(field("shader", "Phong"));
+	RAY_TREE(field("material", materialColor));
+	RAY_TREE(field("lightVisible", lightVisible));
+	RAY_TREE(field("lightMultiplier", lightMultiplier));
+	RAY_TREE(field("normDotL", normDotL));
+	RAY_TREE(field("diffuse", lambertResult));
 	
+	Color result = lambertResult;
 	if (lightVisible) {
-		Vector fromLight = info.ip - lightPos;
+		Vector fromLight = info.ip - rc.lightPos;
 		fromLight.normalize();
 		
 		Vector r = reflect(fromLight, nrm);
 		Vector toCamera = ray.start - info.ip;
 		toCamera.normalize();
 		double cosGamma = dot(toCamera, r);
-		Color specularResult = lightIntensity * float(pow(cosGamma, exponent) / sqr(lightDist));
-		return lambertResult + specularResult;
-	} else return lambertResult;
+		Color specularResult = rc.lightIntensity * float(pow(cosGamma, exponent) / sqr(lightDist));
+		RAY_TREE(field("cosGamma", cosGamma));
+		RAY_TREE(field("specular", specularResult));
+		result += specularResult;
+	}
+	RAY_TREE(field("result", result));
+	RAY_TREE(end());
+	return result;
 }
 
 
@@ -124,12 +215,26 @@ BitmapTexture::BitmapTexture(const char* filename, double _scaling)
 
 BitmapTexture::~BitmapTexture(){ if (map) delete map; }
 
-Color BitmapTexture::getTexColor(const IntersectionInfo& info)
+inline Color BitmapTexture::sample(double u, double v) const
 {
-	if (!map) return Color(0, 0, 0);
-	double u = info.u / scaling;
-	double v = info.v / scaling;
+	u /= scaling;
+	v /= scaling;
 	double fracu = u - floor(u);
 	double fracv = v - floor(v);
 	return map->getPixel((int) floor(fracu * map->getWidth()), (int) floor(fracv * map->getHeight()));
 }
+
+Color BitmapTexture::getTexColor(const IntersectionInfo& info)
+{
+	if (!map) return Color(0, 0, 0);
+	return sample(info.u, info.v);
+}
+
+void BitmapTexture::getTexColors(const IntersectionInfo* infos, Color* out, int n)
+{
+	if (!map) {
+		for (int i = 0; i < n; i++) out[i] = Color(0, 0, 0);
+		return;
+	}
+	for (int i = 0; i < n; i++) out[i] = sample(infos[i].u, infos[i].v);
+}
@@ -30,6 +30,38 @@ public:
 	virtual ~Shader() {}
 	
 	virtual Color shade(const Ray& ray, const IntersectionInfo& info) = 0;
+	
+	/// returns true if the shader needs to know whether the light is visible from the shading
+	/// point. Such shaders implement shadeWithVisibility(), so a renderer may trace the
+	/// shadow rays in bulk, before shading.
+	virtual bool needsShadowRay(void) const { return false; }
+	
+	/// returns true if the shader reads info.u and info.v; if not, the geometry may skip computing them
+	virtual bool needsUV(void) const { return true; }
+	
+	/// like shade(), but the visibility of the light from info.ip is already known
+	virtual Color shadeWithVisibility(const Ray& ray, const IntersectionInfo& info, bool lightVisible)
+	{
+		return shade(ray, info);
+	}
+	
+	/// shades n hits at once, writing the results to out[]. A renderer may group the hits
+	/// by shader and call this once per group, so shaders can process them in a tight loop.
+	virtual void shadeBatch(const Ray* rays, const IntersectionInfo* infos, const unsigned char* lightVisible, Color* out, int n)
+	{
+		for (int i = 0; i < n; i++) out[i] = shadeWithVisibility(rays[i], infos[i], lightVisible[i] != 0);
+	}
+	
+	/// for global illumination: the fraction of the incoming light, which is reflected diffusely
+	/// (black for shaders, which don't reflect light)
+	virtual Color getAlbedo(const IntersectionInfo& info) { return Color(0, 0, 0); }
+	
+	/// for global illumination: the light from the light source, reflected towards the ray origin,
+	/// without any ambient term (the indirect light is computed instead)
+	virtual Color shadeDirect(const Ray& ray, const IntersectionInfo& info, bool lightVisible)
+	{
+		return shadeWithVisibility(ray, info, lightVisible);
+	}
 };
 
 /// An abstract class, representing a (2D) texture
@@ -37,34 +69,53 @@ class Texture {
 public:
 	virtual ~Texture() {}
 	virtual Color getTexColor(const IntersectionInfo& info) = 0;
+	
+	/// gets the texture colors for n hits at once
+	virtual void getTexColors(const IntersectionInfo* infos, Color* out, int n)
+	{
+		for (int i = 0; i < n; i++) out[i] = getTexColor(infos[i]);
+	}
 };
 
 /// A checker texture
 class Checker: public Texture {
 	Color col1, col2; /// the colors of the alternating squares
 	double squareSize; /// the size of a square side, in world units
+	inline Color sample(double u, double v) const;
 public:
 	Checker(Color c1, Color c2, double size) { col1 = c1; col2 = c2; squareSize = size; }
 	Color getTexColor(const IntersectionInfo& info);
+	void getTexColors(const IntersectionInfo* infos, Color* out, int n);
 };
 
 class Bitmap;
 class BitmapTexture: public Texture {
 	Bitmap* map;
 	double scaling;
+	inline Color sample(double u, double v) const;
 public:
 	BitmapTexture(const char* filename, double _scaling);
 	~BitmapTexture();
 	Color getTexColor(const IntersectionInfo& info);
+	void getTexColors(const IntersectionInfo* infos, Color* out, int n);
 };
 
 /// A Lambert (flat) shader
 class Lambert: public Shader {
 	Color color; //!< This is the static color of the Lambert shader (to be used if a texture isn't present)
 	Texture *texture; //!< a diffuse texture, if not NULL.
+	inline Color getMaterialColor(const IntersectionInfo& info) const;
+	/// applies the lighting (with the given ambient light) to a material color
+	inline Color illuminate(const Color& materialColor, const Ray& ray, const IntersectionInfo& info, bool lightVisible, const Color& ambientLight) const;
 public:
 	Lambert(Color _color, Texture* _texture = NULL ) { color = _color; texture = _texture; }
 	Color shade(const Ray& ray, const IntersectionInfo& info);
+	bool needsShadowRay(void) const { return true; }
+	bool needsUV(void) const { return texture != NULL; }
+	Color shadeWithVisibility(const Ray& ray, const IntersectionInfo& info, bool lightVisible);
+	void shadeBatch(const Ray* rays, const IntersectionInfo* infos, const unsigned char* lightVisible, Color* out, int n);
+	Color getAlbedo(const IntersectionInfo& info);
+	Color shadeDirect(const Ray& ray, const IntersectionInfo& info, bool lightVisible);
 };
 
 /// A Lambert (flat) shader
@@ -72,9 +123,18 @@ class Phong: public Shader {
 	Color color; //!< This is the static color of the Lambert shader (to be used if a texture isn't present)
 	Texture *texture; //!< a diffuse texture, if not NULL.
 	double exponent;
+	inline Color getMaterialColor(const IntersectionInfo& info) const;
+	/// applies the lighting (with the given ambient light) to a material color
+	inline Color illuminate(const Color& materialColor, const Ray& ray, const IntersectionInfo& info, bool lightVisible, const Color& ambientLight) const;
 public:
 	Phong(Color _color, double _exponent, Texture* _texture = NULL ) { color = _color; texture = _texture; exponent = _exponent; }
 	Color shade(const Ray& ray, const IntersectionInfo& info);
+	bool needsShadowRay(void) const { return true; }
+	bool needsUV(void) const { return texture != NULL; }
+	Color shadeWithVisibility(const Ray& ray, const IntersectionInfo& info, bool lightVisible);
+	void shadeBatch(const Ray* rays, const IntersectionInfo* infos, const unsigned char* lightVisible, Color* out, int n);
+	Color getAlbedo(const IntersectionInfo& info);
+	Color shadeDirect(const Ray& ray, const IntersectionInfo& info, bool lightVisible);
 };
 
 #endif // __SHADING_H__
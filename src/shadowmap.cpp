@@ -0,0 +1,123 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2012 by Veselin Georgiev, Slavomir Kaslev et al    *
+ *   admin@raytracing-bg.net                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <math.h>
+#include "shadowmap.h"
+#include "bvh.h"
+#include "threads.h"
+#include "constants.h"
+
+/// how far (in texels) the depths of the 2x2 texels of a lookup may differ, before they're
+/// considered a discontinuity: that's how far a surface may be tilted, relative to the light's
+/// rays, before lookup() gives up on it. 4 texels allow for tilts up to ~76 degrees.
+const double SHADOW_MAP_SLOPE = 4;
+/// the depth bias (in texels), for the imprecision of interpolating the depth of a smooth surface
+const double SHADOW_MAP_BIAS = 0.5;
+
+const int SHADOW_MAP_CHUNK = 4; //!< rows per parallelFor() chunk, while building
+
+static inline double component(const Vector& v, int axis)
+{
+	return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+}
+
+ShadowMap::ShadowMap()
+{
+	size = 0;
+	slopeTolerance = depthTolerance = 0;
+	bvh = NULL;
+}
+
+void ShadowMap::clear(void)
+{
+	size = 0;
+	depth.clear();
+}
+
+/// traces the rows [begin..end) of all faces, as a parallelFor() kernel
+void ShadowMap::kernelBuild(int begin, int end, void* data)
+{
+	ShadowMap* map = (ShadowMap*) data;
+	int n = map->size;
+	for (int row = begin; row < end; row++) {
+		int face = row / n, axis = face / 2;
+		double t = (row % n + 0.5) * 2.0 / n - 1;
+		for (int col = 0; col < n; col++) {
+			double s = (col + 0.5) * 2.0 / n - 1;
+			double c[3];
+			c[axis] = face % 2 ? -1 : 1;
+			c[(axis + 1) % 3] = s;
+			c[(axis + 2) % 3] = t;
+			Ray ray(map->light, Vector(c[0], c[1], c[2]));
+			ray.dir.normalize();
+			IntersectionInfo info;
+			map->depth[row * n + col] = map->bvh->intersect(ray, info) ? (float) info.distance : (float) INF;
+		}
+	}
+}
+
+void ShadowMap::build(const BVH& _bvh, const Vector& _light, int _size)
+{
+	size = _size;
+	light = _light;
+	// a texel spans about 2/size radians, i.e. 2/size units of depth per unit of distance at 45 degrees:
+	slopeTolerance = SHADOW_MAP_SLOPE * 2.0 / size;
+	depthTolerance = SHADOW_MAP_BIAS * 2.0 / size;
+	depth.resize(6 * size * size);
+	bvh = &_bvh;
+	parallelFor(6 * size, SHADOW_MAP_CHUNK, kernelBuild, this);
+	bvh = NULL;
+}
+
+ShadowQuery ShadowMap::lookup(const Vector& dir, double dist) const
+{
+	// find the face and the position on it:
+	double ax = fabs(dir.x), ay = fabs(dir.y), az = fabs(dir.z);
+	int axis = ax >= ay && ax >= az ? 0 : (ay >= az ? 1 : 2);
+	double major = component(dir, axis);
+	int face = 2 * axis + (major < 0 ? 1 : 0);
+	double s = component(dir, (axis + 1) % 3) / fabs(major);
+	double t = component(dir, (axis + 2) % 3) / fabs(major);
+	// the 2x2 texels around it (clamped at the edges of the face):
+	double fs = (s + 1) * 0.5 * size - 0.5, ft = (t + 1) * 0.5 * size - 0.5;
+	int c0 = (int) floor(fs), r0 = (int) floor(ft);
+	double ws = fs - c0, wt = ft - r0;
+	int c1 = c0 + 1, r1 = r0 + 1;
+	if (c0 < 0) c0 = 0;
+	if (r0 < 0) r0 = 0;
+	if (c1 > size - 1) c1 = size - 1;
+	if (r1 > size - 1) r1 = size - 1;
+	const float* f = &depth[face * size * size];
+	float d[4] = { f[r0 * size + c0], f[r0 * size + c1], f[r1 * size + c0], f[r1 * size + c1] };
+	float minDepth = d[0], maxDepth = d[0];
+	for (int i = 1; i < 4; i++) {
+		if (d[i] < minDepth) minDepth = d[i];
+		if (d[i] > maxDepth) maxDepth = d[i];
+	}
+	if (minDepth == (float) INF) return SHADOW_VISIBLE; // nothing there at all
+	// a discontinuity (or a surface, seen at a grazing angle): the texels may miss what's in between
+	if (maxDepth - minDepth > dist * slopeTolerance) return SHADOW_UNSURE;
+	// a single smooth surface: compare with its (interpolated) depth
+	double surface = (d[0] * (1 - ws) + d[1] * ws) * (1 - wt) + (d[2] * (1 - ws) + d[3] * ws) * wt;
+	double bias = dist * depthTolerance;
+	if (dist < surface + bias) return SHADOW_VISIBLE; // the point is that surface, or in front of it
+	if (dist > surface + 2 * bias) return SHADOW_OCCLUDED; // it's behind it
+	return SHADOW_UNSURE;
+}
@@ -0,0 +1,71 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2012 by Veselin Georgiev, Slavomir Kaslev et al    *
+ *   admin@raytracing-bg.net                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#ifndef __SHADOWMAP_H__
+#define __SHADOWMAP_H__
+
+#include <vector>
+#include "vector.h"
+
+class BVH;
+
+const int MAX_SHADOW_MAP_SIZE = 2048; //!< the largest face resolution (6 x 2048^2 floats = 96 MB)
+
+/// the answer of ShadowMap::lookup()
+enum ShadowQuery {
+	SHADOW_VISIBLE, //!< the point is lit
+	SHADOW_OCCLUDED, //!< something blocks the light
+	SHADOW_UNSURE //!< the map can't tell; trace the exact shadow ray
+};
+
+/// An omnidirectional shadow map: six depth images on the faces of a cube around a point light,
+/// holding the distance from the light to the first surface in the direction of each texel's center.
+/// A shadow query towards that light is then answered in constant time, by interpolating the
+/// 2x2 texels around the query direction and comparing the result with the distance to the
+/// shading point. Where these texels disagree (near the silhouettes of occluders, or on surfaces,
+/// seen by the light at grazing angles), lookup() leaves the query to an exact ray cast.
+///
+/// The map is a snapshot: it must be rebuilt whenever the scene or the light moves (see
+/// RenderContext::prepareFrame()).
+class ShadowMap {
+	int size; //!< the resolution of a face (0 if the map isn't built)
+	Vector light; //!< the position, the map was built from
+	double slopeTolerance; //!< the depth difference (relative to the distance from the light), which is a discontinuity
+	double depthTolerance; //!< the depth bias, relative to the distance from the light
+	/// size x size texels per face. On face f, axis f / 2 is the major one, and its sign is
+	/// positive for even f; the rows and columns follow the next two axes, in cyclic order.
+	std::vector<float> depth;
+	const BVH* bvh; //!< while building
+	
+	static void kernelBuild(int begin, int end, void* data);
+public:
+	ShadowMap();
+	
+	/// traces the 6 x size x size rays of the map, with the rendering threads
+	void build(const BVH& bvh, const Vector& light, int size);
+	void clear(void);
+	int getSize(void) const { return size; }
+	bool isBuiltFor(const Vector& l) const { return size > 0 && l.x == light.x && l.y == light.y && l.z == light.z; }
+	
+	/// answers, whether the point at distance `dist' from the light, in the (normalized)
+	/// direction dir, is visible from it
+	ShadowQuery lookup(const Vector& dir, double dist) const;
+};
+
+#endif // __SHADOWMAP_H__
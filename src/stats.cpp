@@ -0,0 +1,72 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2012 by Veselin Georgiev, Slavomir Kaslev et al    *
+ *   admin@raytracing-bg.net                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <SDL/SDL.h>
+#include <SDL/SDL_thread.h>
+#include <stdio.h>
+#include "stats.h"
+
+THREAD_LOCAL RenderStats threadStats;
+RenderStats renderStats;
+static SDL_mutex* statsMutex = SDL_CreateMutex(); //!< guards renderStats
+
+void RenderStats::reset(void)
+{
+	rays = 0;
+	intersectionTests = 0;
+	shadowRays = 0;
+	shadowCacheHits = 0;
+	shadowMapHits = 0;
+	paths = 0;
+	pathVertices = 0;
+}
+
+void RenderStats::add(const RenderStats& rhs)
+{
+	rays += rhs.rays;
+	intersectionTests += rhs.intersectionTests;
+	shadowRays += rhs.shadowRays;
+	shadowCacheHits += rhs.shadowCacheHits;
+	shadowMapHits += rhs.shadowMapHits;
+	paths += rhs.paths;
+	pathVertices += rhs.pathVertices;
+}
+
+void RenderStats::print(void) const
+{
+	printf("Rays: %lld, intersection tests: %lld\n", rays, intersectionTests);
+	printf("Shadow rays: %lld", shadowRays);
+	if (shadowRays > 0) {
+		if (shadowMapHits > 0)
+			printf(", resolved by the shadow map: %lld (%.1lf%%)", shadowMapHits, 100.0 * shadowMapHits / shadowRays);
+		printf(", resolved by the last-occluder cache: %lld (%.1lf%%)", shadowCacheHits, 100.0 * shadowCacheHits / shadowRays);
+	}
+	printf("\n");
+	if (paths > 0)
+		printf("Paths: %lld, average length: %.2lf bounces\n", paths, pathVertices / (double) paths);
+}
+
+void mergeThreadStats(void)
+{
+	SDL_mutexP(statsMutex);
+	renderStats.add(threadStats);
+	SDL_mutexV(statsMutex);
+	threadStats.reset();
+}
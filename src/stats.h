@@ -0,0 +1,46 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2012 by Veselin Georgiev, Slavomir Kaslev et al    *
+ *   admin@raytracing-bg.net                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include "util.h"
+
+/// Counters, collected while rendering. Every thread accumulates into its own
+/// copy (threadStats), which is added to the global one (renderStats) by mergeThreadStats().
+struct RenderStats {
+	long long rays; //!< closest-hit queries (BVH::intersect() calls)
+	long long intersectionTests; //!< ray-node tests, done by the closest-hit and the shadow queries
+	long long shadowRays; //!< number of lightIsVisible() queries
+	long long shadowCacheHits; //!< shadow rays, resolved by the last-occluder cache
+	long long shadowMapHits; //!< shadow rays, resolved by the shadow map (without tracing)
+	long long paths; //!< camera paths, traced by the path tracer
+	long long pathVertices; //!< the surface hits along these paths
+	
+	void reset(void); //!< zeroes all counters
+	void add(const RenderStats& rhs); //!< accumulates the counters of rhs into this
+	void print(void) const; //!< prints the counters to stdout
+};
+
+extern THREAD_LOCAL RenderStats threadStats; //!< the counters of the calling thread
+extern RenderStats renderStats; //!< the counters of all threads, after they're merged
+
+void mergeThreadStats(void); //!< adds the calling thread's counters to renderStats and zeroes them
+
+#endif // __STATS_H__
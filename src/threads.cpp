@@ -0,0 +1,170 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2012 by Veselin Georgiev, Slavomir Kaslev et al    *
+ *   admin@raytracing-bg.net                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <SDL/SDL.h>
+#include <SDL/SDL_thread.h>
+#include <vector>
+#include "threads.h"
+#include "stats.h"
+#include "context.h"
+#ifdef _WIN32
+#	include <windows.h>
+#else
+#	include <unistd.h>
+#endif
+using std::vector;
+
+/// a parallelFor() call in progress
+struct ParallelJob {
+	ParallelKernel kernel;
+	void* data;
+	RenderContext* context; //!< the caller's; the chunks run with it as the current context
+	int count, chunkSize;
+	int nextItem; //!< the first item, which isn't taken yet
+	int itemsDone;
+	SDL_cond* finished;
+};
+
+static int threadCount = 0;
+static vector<SDL_Thread*> workers;
+static vector<ParallelJob*> jobs; //!< jobs with chunks, which aren't taken yet
+static SDL_mutex* poolMutex = NULL;
+static SDL_cond* workAvailable = NULL;
+static bool quitting = false;
+
+static int getCPUCount(void)
+{
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return (int) info.dwNumberOfProcessors;
+#else
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return n > 0 ? (int) n : 1;
+#endif
+}
+
+void setThreadCount(int count)
+{
+	threadCount = count > 0 ? count : getCPUCount();
+}
+
+int getThreadCount(void)
+{
+	if (!threadCount) setThreadCount(0);
+	return threadCount;
+}
+
+/// takes the next chunk of the oldest job with work left. Must be called with poolMutex held.
+static bool takeChunk(ParallelJob*& job, int& begin, int& end)
+{
+	if (jobs.empty()) return false;
+	job = jobs[0];
+	begin = job->nextItem;
+	end = begin + job->chunkSize < job->count ? begin + job->chunkSize : job->count;
+	job->nextItem = end;
+	if (end == job->count) jobs.erase(jobs.begin());
+	return true;
+}
+
+/// runs a chunk (with poolMutex held on entry and exit)
+static void runChunk(ParallelJob* job, int begin, int end)
+{
+	SDL_mutexV(poolMutex);
+	RenderContext* saved = currentContext;
+	currentContext = job->context;
+	job->kernel(begin, end, job->data);
+	currentContext = saved;
+	mergeThreadStats();
+	SDL_mutexP(poolMutex);
+	job->itemsDone += end - begin;
+	if (job->itemsDone == job->count) SDL_CondBroadcast(job->finished);
+}
+
+static int workerThread(void* unused)
+{
+	SDL_mutexP(poolMutex);
+	while (!quitting) {
+		ParallelJob* job;
+		int begin, end;
+		if (takeChunk(job, begin, end)) runChunk(job, begin, end);
+		else SDL_CondWait(workAvailable, poolMutex);
+	}
+	SDL_mutexV(poolMutex);
+	return 0;
+}
+
+void initThreads(void)
+{
+	if (poolMutex) return;
+	poolMutex = SDL_CreateMutex();
+	workAvailable = SDL_CreateCond();
+	quitting = false;
+	for (int i = 1; i < getThreadCount(); i++)
+		workers.push_back(SDL_CreateThread(workerThread, NULL));
+}
+
+void parallelFor(int count, int chunkSize, ParallelKernel kernel, void* data)
+{
+	if (count <= 0) return;
+	if (chunkSize < 1) chunkSize = 1;
+	if (getThreadCount() == 1 || count <= chunkSize) {
+		kernel(0, count, data);
+		return;
+	}
+	if (!poolMutex) initThreads();
+	ParallelJob job;
+	job.kernel = kernel;
+	job.data = data;
+	job.context = currentContext;
+	job.count = count;
+	job.chunkSize = chunkSize;
+	job.nextItem = 0;
+	job.itemsDone = 0;
+	job.finished = SDL_CreateCond();
+	SDL_mutexP(poolMutex);
+	jobs.push_back(&job);
+	SDL_CondBroadcast(workAvailable);
+	// help out, until all chunks of our job are taken:
+	while (job.nextItem < job.count) {
+		ParallelJob* taken;
+		int begin, end;
+		if (!takeChunk(taken, begin, end)) break;
+		runChunk(taken, begin, end);
+	}
+	while (job.itemsDone < job.count) SDL_CondWait(job.finished, poolMutex);
+	SDL_mutexV(poolMutex);
+	SDL_DestroyCond(job.finished);
+}
+
+void closeThreads(void)
+{
+	if (!poolMutex) return;
+	SDL_mutexP(poolMutex);
+	quitting = true;
+	SDL_CondBroadcast(workAvailable);
+	SDL_mutexV(poolMutex);
+	for (int i = 0; i < (int) workers.size(); i++) SDL_WaitThread(workers[i], NULL);
+	workers.clear();
+	SDL_DestroyCond(workAvailable);
+	SDL_DestroyMutex(poolMutex);
+	poolMutex = NULL;
+	workAvailable = NULL;
+}
@@ -0,0 +1,44 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2012 by Veselin Georgiev, Slavomir Kaslev et al    *
+ *   admin@raytracing-bg.net                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#ifndef __THREADS_H__
+#define __THREADS_H__
+
+/// a piece of parallel work: processes the items [begin..end). `data' is passed from parallelFor()
+typedef void (*ParallelKernel)(int begin, int end, void* data);
+
+/// sets the number of rendering threads (including the calling one). 0 means "one per CPU".
+/// Must be called before the first parallelFor().
+void setThreadCount(int count);
+int getThreadCount(void); //!< returns the number of rendering threads
+
+/// runs kernel over the items [0..count), split into chunks of (at most) chunkSize items,
+/// which are spread among the rendering threads. The calling thread takes part, too, and
+/// the function returns when all chunks are done. Several threads may call parallelFor()
+/// at the same time; their chunks then share the pool. The chunks run with the caller's
+/// render context (see context.h) as the current one.
+void parallelFor(int count, int chunkSize, ParallelKernel kernel, void* data);
+
+/// starts the worker threads. The first parallelFor() does that, too, but if several threads may
+/// make their first call at the same time, call this before starting them.
+void initThreads(void);
+
+void closeThreads(void); //!< stops the worker threads
+
+#endif // __THREADS_H__
@@ -0,0 +1,95 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2012 by Veselin Georgiev, Slavomir Kaslev et al    *
+ *   admin@raytracing-bg.net                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#ifndef __TRANSFORM_H__
+#define __TRANSFORM_H__
+
+#include "matrix.h"
+#include "util.h"
+
+/// A transformation of the 3D space (scaling, rotation and translation), with
+/// methods to apply it (object space -> world space) or undo it.
+class Transform {
+	Matrix transform; //!< the linear part (scaling and rotation)
+	Matrix inverseTransform; //!< ... and its inverse
+	Matrix transposedInverse; //!< for transforming normals
+	Vector offset; //!< the translation
+	bool identity; //!< true if no transformation is set (so it can be skipped)
+	
+	void updateInverse(void)
+	{
+		inverseTransform = inverseMatrix(transform);
+		transposedInverse = transpose(inverseTransform);
+		identity = false;
+	}
+public:
+	Transform() { reset(); }
+	
+	void reset(void)
+	{
+		transform = inverseTransform = transposedInverse = Matrix(1);
+		offset.makeZero();
+		identity = true;
+	}
+	
+	bool isIdentity(void) const { return identity; }
+	
+	void scale(double X, double Y, double Z)
+	{
+		Matrix scaling(X);
+		scaling.m[1][1] = Y;
+		scaling.m[2][2] = Z;
+		transform = transform * scaling;
+		updateInverse();
+	}
+	
+	/// rotates with the given angles (in degrees), in the same order as the Camera does
+	void rotate(double yaw, double pitch, double roll)
+	{
+		transform = transform *
+			rotationAroundZ(toRadians(roll)) *
+			rotationAroundX(toRadians(pitch)) *
+			rotationAroundY(toRadians(yaw));
+		updateInverse();
+	}
+	
+	void translate(const Vector& V)
+	{
+		offset = offset + V;
+		identity = false;
+	}
+	
+	Vector point(Vector P) const { return P * transform + offset; } //!< object space -> world space
+	Vector undoPoint(Vector P) const { return (P - offset) * inverseTransform; } //!< world space -> object space
+	Vector direction(const Vector& dir) const { return dir * transform; }
+	Vector undoDirection(const Vector& dir) const { return dir * inverseTransform; }
+	Vector normal(const Vector& norm) const { return norm * transposedInverse; } //!< transforms a normal to world space
+	
+	/// transforms a ray to object space. The direction isn't normalized, so distances
+	/// along the resulting ray are the same as in world space.
+	Ray undoRay(const Ray& ray) const
+	{
+		Ray result = ray;
+		result.start = undoPoint(ray.start);
+		result.dir = undoDirection(ray.dir);
+		return result;
+	}
+};
+
+#endif // __TRANSFORM_H__
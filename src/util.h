@@ -24,6 +24,14 @@
 #include <math.h>
 #include "constants.h"
 
+// THREAD_LOCAL marks a global as having a separate instance in each thread.
+// Only use it on plain structs/PODs (no constructors)
+#ifdef _MSC_VER
+#	define THREAD_LOCAL __declspec(thread)
+#else
+#	define THREAD_LOCAL __thread
+#endif
+
 inline double signOf(double x) { return x > 0 ? +1 : -1; }
 inline double sqr(double a) { return a * a; }
 inline double toRadians(double angle) { return angle / 180.0 * PI; }
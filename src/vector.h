@@ -135,8 +135,7 @@ inline Vector faceforward(const Vector& v, const Vector& right)
 
 struct Ray {
 	Vector start, dir;
-	bool debug;
-	Ray() { debug = false; }
+	Ray() {}
 	Ray(const Vector& _start, const Vector& _dir) {
 		start = _start;
 		dir = _dir;
@@ -0,0 +1,336 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2012 by Veselin Georgiev, Slavomir Kaslev et al    *
+ *   admin@raytracing-bg.net                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "wavefront.h"
+#include "camera.h"
+#include "geometry.h"
+#include "shading.h"
+#include "bvh.h"
+#include "threads.h"
+#include "sdl.h"
+#include "denoise.h"
+#include "sampler.h"
+#include "context.h"
+using std::vector;
+
+extern bool needsAA(const Color* p, int stride, int x, int y);
+extern void isOccludedPacket(const Vector& light, const Vector* dirs, const double* maxDist, int count, unsigned char* occluded);
+
+const int BATCH_SIZE = 1 << 16; //!< rays per wave
+const int CHUNK_SIZE = 1024; //!< rays per parallelFor() chunk
+const int PACKET_TILE_SIZE = 8; //!< the primary rays are generated in tiles of that many pixels squared
+
+void RayQueue::resize(int n)
+{
+	ox.resize(n); oy.resize(n); oz.resize(n);
+	dx.resize(n); dy.resize(n); dz.resize(n);
+	owner.resize(n);
+	size = n;
+}
+
+/// the state of a batch of rays, going through the pipeline
+struct Wave {
+	RayQueue rays;
+	vector<Node*> hitNode; //!< per ray: the closest node (or NULL)
+	vector<IntersectionInfo> hitInfo; //!< per ray: the closest intersection
+	RayQueue shadowRays; //!< owner is the index of the ray, whose hit emitted it
+	vector<double> shadowDist; //!< per shadow ray: the distance to the shading point
+	vector<unsigned char> lightVisible; //!< per ray: whether the light is visible from the hit
+	vector<Color> result; //!< per ray: the shaded color
+	
+	// the hits, sorted by shader, for batched shading:
+	vector<int> order; //!< index of the ray for each sorted hit
+	vector<Shader*> sortedShader;
+	vector<Ray> sortedRays;
+	vector<IntersectionInfo> sortedInfo;
+	vector<unsigned char> sortedVisible;
+	vector<Color> sortedResult;
+	int hits; //!< how many of the rays hit something
+	
+	void resize(int n)
+	{
+		rays.resize(n);
+		hitNode.resize(n);
+		hitInfo.resize(n);
+		shadowRays.resize(n);
+		shadowDist.resize(n);
+		lightVisible.resize(n);
+		result.resize(n);
+		order.resize(n);
+		sortedShader.resize(n);
+		sortedRays.resize(n);
+		sortedInfo.resize(n);
+		sortedVisible.resize(n);
+		sortedResult.resize(n);
+	}
+};
+
+/// parameters of the ray generation kernel
+struct RayGenJob {
+	Wave* wave;
+	int base; //!< index of the first sample in this wave
+	const vector<int>* pixels; //!< the pixels to be sampled, in the order of their rays
+	int samples; //!< rays per pixel: 1 for the primary pass (through the pixel centers), AA_SAMPLES for the AA pass
+};
+
+static void kernelGenerateRays(int begin, int end, void* data)
+{
+	Camera& camera = currentContext->camera;
+	RayGenJob* job = (RayGenJob*) data;
+	RayQueue& q = job->wave->rays;
+	int W = frameWidth();
+	for (int i = begin; i < end; i++) {
+		int sample = job->base + i;
+		int pixel = (*job->pixels)[sample / job->samples];
+		int x = pixel % W, y = pixel / W;
+		if (job->samples > 1) {
+			double dx, dy;
+			getPixelSample(x, y, sample % job->samples, job->samples, dx, dy);
+			q.set(i, camera.getScreenRay(x + dx, y + dy), pixel);
+		} else {
+			q.set(i, camera.getScreenRay(x, y), pixel);
+		}
+	}
+}
+
+/// lists the pixels of a W x H frame tile by tile, so that consecutive primary rays (and the
+/// shadow rays of their hits) go through neighbouring pixels, in both directions
+static void tileOrder(int W, int H, vector<int>& pixels)
+{
+	pixels.clear();
+	pixels.reserve(W * H);
+	for (int ty = 0; ty < H; ty += PACKET_TILE_SIZE)
+		for (int tx = 0; tx < W; tx += PACKET_TILE_SIZE)
+			for (int y = ty; y < ty + PACKET_TILE_SIZE && y < H; y++)
+				for (int x = tx; x < tx + PACKET_TILE_SIZE && x < W; x++)
+					pixels.push_back(y * W + x);
+}
+
+static void kernelIntersect(int begin, int end, void* data)
+{
+	const BVH& bvh = currentContext->bvh;
+	Wave* w = (Wave*) data;
+	for (int i = begin; i < end; i++)
+		w->hitNode[i] = bvh.intersect(w->rays.get(i), w->hitInfo[i]);
+}
+
+/// emits a shadow ray for every hit, whose shader needs one, at the same index as the ray.
+/// Rays without a shadow ray get a negative distance; the queue is compacted afterwards.
+static void kernelEmitShadowRays(int begin, int end, void* data)
+{
+	const Vector& lightPos = currentContext->lightPos;
+	Wave* w = (Wave*) data;
+	for (int i = begin; i < end; i++) {
+		w->lightVisible[i] = 0;
+		Node* node = w->hitNode[i];
+		if (!node || !node->shader->needsShadowRay()) {
+			w->shadowDist[i] = -1;
+			continue;
+		}
+		// the same ray as the one lightIsVisible() would trace:
+		Vector LP = w->hitInfo[i].ip - lightPos;
+		double len = LP.length();
+		LP.normalize();
+		w->shadowRays.set(i, Ray(lightPos, LP), i);
+		w->shadowDist[i] = len - 1e-6;
+	}
+}
+
+/// moves the emitted shadow rays to the front of the queue
+static void compactShadowRays(Wave& w)
+{
+	RayQueue& q = w.shadowRays;
+	int n = 0;
+	for (int i = 0; i < w.rays.size; i++) {
+		if (w.shadowDist[i] < 0) continue;
+		if (n != i) {
+			q.ox[n] = q.ox[i]; q.oy[n] = q.oy[i]; q.oz[n] = q.oz[i];
+			q.dx[n] = q.dx[i]; q.dy[n] = q.dy[i]; q.dz[n] = q.dz[i];
+			q.owner[n] = q.owner[i];
+			w.shadowDist[n] = w.shadowDist[i];
+		}
+		n++;
+	}
+	q.size = n;
+}
+
+/// traces the shadow rays in packets of MAX_PACKET_SIZE consecutive ones. They all start at the light,
+/// and consecutive rays come from neighbouring pixels (see tileOrder()), so a packet is a narrow bundle.
+static void kernelTraceShadowPackets(int begin, int end, void* data)
+{
+	const Vector& lightPos = currentContext->lightPos;
+	Wave* w = (Wave*) data;
+	const RayQueue& q = w->shadowRays;
+	Vector dirs[MAX_PACKET_SIZE];
+	unsigned char occluded[MAX_PACKET_SIZE];
+	for (int p = begin; p < end; p++) {
+		int first = p * MAX_PACKET_SIZE;
+		int count = q.size - first < MAX_PACKET_SIZE ? q.size - first : MAX_PACKET_SIZE;
+		for (int i = 0; i < count; i++) dirs[i] = Vector(q.dx[first + i], q.dy[first + i], q.dz[first + i]);
+		isOccludedPacket(lightPos, dirs, &w->shadowDist[first], count, occluded);
+		for (int i = 0; i < count; i++) w->lightVisible[q.owner[first + i]] = !occluded[i];
+	}
+}
+
+/// groups the hits by shader (a counting sort), so each shader can process its hits in one
+/// shadeBatch() call. The misses are shaded (in black) right away.
+static void sortHitsByShader(Wave& w)
+{
+	vector<Shader*> shaders;
+	vector<int> shaderOf(w.rays.size);
+	int last = -1;
+	for (int i = 0; i < w.rays.size; i++) {
+		if (!w.hitNode[i]) {
+			shaderOf[i] = -1;
+			w.result[i] = Color(0, 0, 0);
+			continue;
+		}
+		Shader* shader = w.hitNode[i]->shader;
+		// neighbouring rays usually hit the same thing, so check the last shader first:
+		if (last == -1 || shaders[last] != shader) {
+			for (last = 0; last < (int) shaders.size() && shaders[last] != shader; last++);
+			if (last == (int) shaders.size()) shaders.push_back(shader);
+		}
+		shaderOf[i] = last;
+	}
+	vector<int> start(shaders.size() + 1, 0);
+	for (int i = 0; i < w.rays.size; i++)
+		if (shaderOf[i] != -1) start[shaderOf[i] + 1]++;
+	for (int i = 0; i < (int) shaders.size(); i++) start[i + 1] += start[i];
+	w.hits = start[shaders.size()];
+	for (int i = 0; i < w.rays.size; i++) {
+		if (shaderOf[i] == -1) continue;
+		int k = start[shaderOf[i]]++;
+		w.order[k] = i;
+		w.sortedShader[k] = shaders[shaderOf[i]];
+	}
+}
+
+/// shades a range of the sorted hits: gathers them into contiguous arrays, calls shadeBatch() for each
+/// run of hits with the same shader, and scatters the results back
+static void kernelShadeSorted(int begin, int end, void* data)
+{
+	Wave* w = (Wave*) data;
+	for (int k = begin; k < end; k++) {
+		int i = w->order[k];
+		w->sortedRays[k] = w->rays.get(i);
+		w->sortedInfo[k] = w->hitInfo[i];
+		w->sortedVisible[k] = w->lightVisible[i];
+	}
+	for (int k = begin, runEnd; k < end; k = runEnd) {
+		Shader* shader = w->sortedShader[k];
+		for (runEnd = k + 1; runEnd < end && w->sortedShader[runEnd] == shader; runEnd++);
+		shader->shadeBatch(&w->sortedRays[k], &w->sortedInfo[k], &w->sortedVisible[k], &w->sortedResult[k], runEnd - k);
+	}
+	for (int k = begin; k < end; k++)
+		w->result[w->order[k]] = w->sortedResult[k];
+}
+
+/// runs all stages of the pipeline over the rays of a wave
+static void traceWave(Wave& w)
+{
+	int n = w.rays.size;
+	parallelFor(n, CHUNK_SIZE, kernelIntersect, &w);
+	parallelFor(n, CHUNK_SIZE, kernelEmitShadowRays, &w);
+	compactShadowRays(w);
+	int packets = (w.shadowRays.size + MAX_PACKET_SIZE - 1) / MAX_PACKET_SIZE;
+	parallelFor(packets, CHUNK_SIZE / MAX_PACKET_SIZE, kernelTraceShadowPackets, &w);
+	sortHitsByShader(w);
+	parallelFor(w.hits, CHUNK_SIZE, kernelShadeSorted, &w);
+}
+
+static void kernelStorePrimary(int begin, int end, void* data)
+{
+	Color (*vfb)[VFB_MAX_SIZE] = currentContext->vfb;
+	AuxBuffers* auxBuffers = currentContext->auxBuffers;
+	Wave* w = (Wave*) data;
+	int W = frameWidth();
+	for (int i = begin; i < end; i++) {
+		int pixel = w->rays.owner[i];
+		vfb[pixel / W][pixel % W] = w->result[i];
+		if (auxBuffers) auxBuffers->record(pixel % W, pixel / W, w->rays.get(i), w->hitNode[i], w->hitInfo[i]);
+	}
+}
+
+/// averages the AA samples of each pixel (they're consecutive in the wave)
+static void kernelStoreAA(int begin, int end, void* data)
+{
+	Color (*vfb)[VFB_MAX_SIZE] = currentContext->vfb;
+	Wave* w = (Wave*) data;
+	int W = frameWidth();
+	for (int i = begin; i < end; i++) {
+		Color accum = Color(0, 0, 0);
+		for (int s = 0; s < AA_SAMPLES; s++) accum += w->result[i * AA_SAMPLES + s];
+		int pixel = w->rays.owner[i * AA_SAMPLES];
+		vfb[pixel / W][pixel % W] = accum / AA_SAMPLES;
+	}
+}
+
+static void kernelDetectAA(int begin, int end, void* data)
+{
+	Color (*vfb)[VFB_MAX_SIZE] = currentContext->vfb;
+	vector<unsigned char>& flags = *(vector<unsigned char>*) data;
+	int W = frameWidth();
+	for (int y = begin; y < end; y++)
+		for (int x = 0; x < W; x++)
+			flags[y * W + x] = needsAA(&vfb[y][x], VFB_MAX_SIZE, x, y);
+}
+
+void renderSceneWavefront(void)
+{
+	int W = frameWidth(), H = frameHeight();
+	int total = W * H;
+	Wave wave;
+	RayGenJob gen;
+	gen.wave = &wave;
+	
+	// primary rays:
+	vector<int> pixels;
+	tileOrder(W, H, pixels);
+	gen.pixels = &pixels;
+	gen.samples = 1;
+	for (gen.base = 0; gen.base < total; gen.base += BATCH_SIZE) {
+		int n = total - gen.base < BATCH_SIZE ? total - gen.base : BATCH_SIZE;
+		wave.resize(n);
+		parallelFor(n, CHUNK_SIZE, kernelGenerateRays, &gen);
+		traceWave(wave);
+		parallelFor(n, CHUNK_SIZE, kernelStorePrimary, &wave);
+	}
+	
+	// find the pixels, which need anti-aliasing (all of them, before any is changed):
+	vector<unsigned char> flags(total);
+	parallelFor(H, 16, kernelDetectAA, &flags);
+	vector<int> aaPixels;
+	for (int i = 0; i < total; i++)
+		if (flags[i]) aaPixels.push_back(i);
+	
+	// AA samples; a wave holds a whole number of pixels:
+	gen.pixels = &aaPixels;
+	gen.samples = AA_SAMPLES;
+	int totalSamples = (int) aaPixels.size() * AA_SAMPLES;
+	const int aaBatch = BATCH_SIZE / AA_SAMPLES * AA_SAMPLES;
+	for (gen.base = 0; gen.base < totalSamples; gen.base += aaBatch) {
+		int n = totalSamples - gen.base < aaBatch ? totalSamples - gen.base : aaBatch;
+		wave.resize(n);
+		parallelFor(n, CHUNK_SIZE, kernelGenerateRays, &gen);
+		traceWave(wave);
+		parallelFor(n / AA_SAMPLES, CHUNK_SIZE / AA_SAMPLES, kernelStoreAA, &wave);
+	}
+}
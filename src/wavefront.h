@@ -0,0 +1,56 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2012 by Veselin Georgiev, Slavomir Kaslev et al    *
+ *   admin@raytracing-bg.net                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#ifndef __WAVEFRONT_H__
+#define __WAVEFRONT_H__
+
+#include <vector>
+#include "vector.h"
+
+/// A queue of rays in structure-of-arrays layout, so that kernels, which process
+/// the whole queue, access memory sequentially.
+struct RayQueue {
+	std::vector<double> ox, oy, oz; //!< ray origins
+	std::vector<double> dx, dy, dz; //!< ray directions
+	std::vector<int> owner; //!< what the ray belongs to (a pixel, a sample, a hit...)
+	int size;
+	
+	RayQueue() { size = 0; }
+	void resize(int n);
+	Ray get(int i) const { return Ray(Vector(ox[i], oy[i], oz[i]), Vector(dx[i], dy[i], dz[i])); }
+	void set(int i, const Ray& ray, int _owner)
+	{
+		ox[i] = ray.start.x; oy[i] = ray.start.y; oz[i] = ray.start.z;
+		dx[i] = ray.dir.x; dy[i] = ray.dir.y; dz[i] = ray.dir.z;
+		owner[i] = _owner;
+	}
+};
+
+/// An alternative to renderScene(), which processes rays in large batches instead of one at a time:
+/// camera rays are generated in a queue, the whole queue is intersected with the scene,
+/// the hits emit shadow rays into a second queue, which is traced in bulk, and only then
+/// the hits are shaded. The primary rays go tile by tile, so the shadow rays of consecutive
+/// hits form coherent bundles from the light, which are traced as packets (BVH::findOccluders()).
+/// The anti-aliasing pass works the same way. Each stage is a separate kernel, run over the
+/// whole queue by parallelFor(). Before shading, the hits are sorted by shader, and every
+/// shader processes its hits with a single Shader::shadeBatch() call (per parallelFor() chunk).
+/// The result is the same as with renderScene().
+void renderSceneWavefront(void);
+
+#endif // __WAVEFRONT_H__